@@ -0,0 +1,419 @@
+// Headless stage-by-stage benchmark for the contouring library.
+//
+// usage: bench [--field perlin|analytic|metaball|all] [--res 250,1000,4000]
+//              [--iters N] [--isolevel L] [--no-interp] [--particles N] [--threads N]
+//              [--cutoff R] [--compact] [--indexed] [--polylines] [--levels N] [--isobands]
+//              [--incremental] [--octaves N] [--pipeline] [--adaptive N] [--collide]
+//              [--trace FILE]
+//
+// Prints one JSON object per (field, resolution, stage) line on stdout. Built
+// with PROFILE=1, --trace also writes the zones of the whole run as a Chrome
+// trace to FILE and their p50/p99 summary to stderr.
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "AdaptiveMarcher/AdaptiveMarcher.hpp"
+#include "BufferStats/BufferStats.hpp"
+#include "ContourSet/ContourSet.hpp"
+#include "FramePipeline/FramePipeline.hpp"
+#include "Grid/Grid.hpp"
+#include "MarchingSquares/MarchingSquares.hpp"
+#include "Particle/Particle.hpp"
+#include "PerlinNoise/PerlinNoise.hpp"
+#include "Profiler/Profiler.hpp"
+
+namespace
+{
+    const float width { 768.0f };
+    const float height { 768.0f };
+    const float DT { 0.025f };
+
+    struct Options
+    {
+        std::vector<std::string> fields { "perlin", "analytic", "metaball" };
+        std::vector<unsigned int> resolutions { 250, 1000, 4000 };
+        unsigned int iters { 10 };
+        float isolevel { 0.5f };
+        bool interp { true };
+        unsigned int particles { 5 };
+        unsigned int threads { 1 };
+        float cutoff { 0.0f }; // metaball influence radius, 0 sums every particle
+        bool compact { false };
+        bool indexed { false };
+        bool polylines { false };
+        unsigned int levels { 0 }; // > 0 also times a ContourSet over N levels in (0, 1)
+        bool isobands { false };
+        bool incremental { false };
+        unsigned int octaves { 0 }; // > 0 uses hashed Perlin noise summing N octaves
+        bool pipeline { false };    // also times whole frames through a FramePipeline
+        unsigned int adaptive { 0 }; // > 0 also times an AdaptiveMarcher splitting each cell up to N times (perlin, analytic)
+        bool collide { false };      // metaball particles bounce off each other
+        std::string trace {};        // Chrome trace output, PROFILE=1 builds only
+    };
+
+    // same analytic field as `f` in main.cpp
+    float f(const glm::vec2& v, const float t)
+    {
+        const float period { 16.0f };
+        return std::abs(cosf(period / width * (v.x + 200.0f + 10.0f * t)) + sinf(period / height * (v.y - 75.0f))) / 2.0f;
+    }
+
+    std::vector<Particle> makeParticles(const unsigned int count)
+    {
+        std::vector<Particle> particles;
+        particles.reserve(count);
+
+        if (count == 5)
+        {
+            // same scene as main.cpp
+            particles.emplace_back(10.0f, glm::vec2(width/2, height/2), glm::vec2(0.0f, height/20));
+            particles.emplace_back(20.0f, glm::vec2(width/4, height * 3.0f/4.0f), glm::vec2(width/15, height/10));
+            particles.emplace_back(25.0f, glm::vec2(width * 7.0f/8.0f, height/8), glm::vec2(-width/50, height/10));
+            particles.emplace_back(7.0f, glm::vec2(width/8, height/4), glm::vec2(-width/20, height/10));
+            particles.emplace_back(15.0f, glm::vec2(width * 3.0f/4.0f, height/2), glm::vec2(width/30, -height/10));
+            return particles;
+        }
+
+        std::mt19937 rng { 1234 };
+        std::uniform_real_distribution<float> radius_dist(2.0f, 12.0f);
+        std::uniform_real_distribution<float> x_dist(0.0f, width);
+        std::uniform_real_distribution<float> y_dist(0.0f, height);
+        std::uniform_real_distribution<float> v_dist(-width/10, width/10);
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            particles.emplace_back(radius_dist(rng), glm::vec2(x_dist(rng), y_dist(rng)), glm::vec2(v_dist(rng), v_dist(rng)));
+        }
+        return particles;
+    }
+
+    template <typename T>
+    std::vector<T> parseList(const char* arg)
+    {
+        std::vector<T> list;
+        std::string s { arg };
+        std::size_t start { 0 };
+        while (start <= s.size())
+        {
+            std::size_t end { s.find(',', start) };
+            if (end == std::string::npos) { end = s.size(); }
+            std::string item { s.substr(start, end - start) };
+            if (!item.empty())
+            {
+                if constexpr (std::is_same_v<T, std::string>) { list.push_back(item); }
+                else { list.push_back(static_cast<T>(std::stoul(item))); }
+            }
+            start = end + 1;
+        }
+        return list;
+    }
+
+    bool parseArgs(int argc, char** argv, Options& opts)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const char* arg { argv[i] };
+            const bool hasValue { i + 1 < argc };
+
+            if (!std::strcmp(arg, "--field") && hasValue)
+            {
+                opts.fields = parseList<std::string>(argv[++i]);
+                if (opts.fields.size() == 1 && opts.fields[0] == "all") { opts.fields = Options{}.fields; }
+            }
+            else if (!std::strcmp(arg, "--res") && hasValue) { opts.resolutions = parseList<unsigned int>(argv[++i]); }
+            else if (!std::strcmp(arg, "--iters") && hasValue) { opts.iters = static_cast<unsigned int>(std::stoul(argv[++i])); }
+            else if (!std::strcmp(arg, "--isolevel") && hasValue) { opts.isolevel = std::stof(argv[++i]); }
+            else if (!std::strcmp(arg, "--no-interp")) { opts.interp = false; }
+            else if (!std::strcmp(arg, "--particles") && hasValue) { opts.particles = static_cast<unsigned int>(std::stoul(argv[++i])); }
+            else if (!std::strcmp(arg, "--threads") && hasValue) { opts.threads = static_cast<unsigned int>(std::stoul(argv[++i])); }
+            else if (!std::strcmp(arg, "--cutoff") && hasValue) { opts.cutoff = std::stof(argv[++i]); }
+            else if (!std::strcmp(arg, "--compact")) { opts.compact = true; }
+            else if (!std::strcmp(arg, "--indexed")) { opts.indexed = true; }
+            else if (!std::strcmp(arg, "--polylines")) { opts.polylines = true; }
+            else if (!std::strcmp(arg, "--levels") && hasValue) { opts.levels = static_cast<unsigned int>(std::stoul(argv[++i])); }
+            else if (!std::strcmp(arg, "--isobands")) { opts.isobands = true; }
+            else if (!std::strcmp(arg, "--incremental")) { opts.incremental = true; }
+            else if (!std::strcmp(arg, "--octaves") && hasValue) { opts.octaves = static_cast<unsigned int>(std::stoul(argv[++i])); }
+            else if (!std::strcmp(arg, "--pipeline")) { opts.pipeline = true; }
+            else if (!std::strcmp(arg, "--adaptive") && hasValue) { opts.adaptive = static_cast<unsigned int>(std::stoul(argv[++i])); }
+            else if (!std::strcmp(arg, "--collide")) { opts.collide = true; }
+            else if (!std::strcmp(arg, "--trace") && hasValue) { opts.trace = argv[++i]; }
+            else
+            {
+                std::cerr << "usage: " << argv[0] << " [--field perlin|analytic|metaball|all] [--res 250,1000,4000]"
+                          << " [--iters N] [--isolevel L] [--no-interp] [--particles N] [--threads N]"
+                          << " [--cutoff R] [--compact] [--indexed] [--polylines] [--levels N] [--isobands]"
+                          << " [--incremental] [--octaves N] [--pipeline] [--adaptive N] [--collide] [--trace FILE]\n";
+                return false;
+            }
+        }
+        return opts.iters > 0;
+    }
+
+    using Clock = std::chrono::steady_clock;
+
+    // keeps the timed copies observable to the optimizer
+    volatile float sink { 0.0f };
+
+    double elapsedMs(const Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    struct StageTimer
+    {
+        double total_ms { 0.0 };
+        double min_ms { INFINITY };
+        unsigned int samples { 0 };
+
+        void add(const double ms)
+        {
+            total_ms += ms;
+            min_ms = std::min(min_ms, ms);
+            ++samples;
+        }
+    };
+
+    // buffers: the marcher's reused buffers for march stages, none (all zero) for the others;
+    // evaluations: field samples taken by the stage, if it samples the field itself
+    void report(const std::string& field, const unsigned int res, const char* stage, const StageTimer& timer, const std::size_t vertices, const Options& opts,
+                const BufferStats& buffers = BufferStats {}, const std::size_t evaluations = 0)
+    {
+        const double cells { static_cast<double>(res - 1) * static_cast<double>(res - 1) };
+        const double mean_ms { timer.total_ms / timer.samples };
+        const double mean_s { mean_ms / 1000.0 };
+
+        std::cout << "{\"field\":\"" << field << "\""
+                  << ",\"resolution\":" << res
+                  << ",\"stage\":\"" << stage << "\""
+                  << ",\"isolevel\":" << opts.isolevel
+                  << ",\"interp\":" << (opts.interp ? "true" : "false")
+                  << ",\"threads\":" << opts.threads
+                  << ",\"cutoff\":" << opts.cutoff
+                  << ",\"indexed\":" << (opts.indexed ? "true" : "false")
+                  << ",\"polylines\":" << (opts.polylines ? "true" : "false")
+                  << ",\"levels\":" << opts.levels
+                  << ",\"isobands\":" << (opts.isobands ? "true" : "false")
+                  << ",\"incremental\":" << (opts.incremental ? "true" : "false")
+                  << ",\"octaves\":" << opts.octaves
+                  << ",\"pipeline\":" << (opts.pipeline ? "true" : "false")
+                  << ",\"adaptive\":" << opts.adaptive
+                  << ",\"samples\":" << timer.samples
+                  << ",\"mean_ms\":" << mean_ms
+                  << ",\"min_ms\":" << timer.min_ms
+                  << ",\"cells\":" << static_cast<unsigned long long>(cells)
+                  << ",\"vertices\":" << vertices
+                  << ",\"cells_per_s\":" << (mean_s > 0.0 ? cells / mean_s : 0.0)
+                  << ",\"vertices_per_s\":" << (mean_s > 0.0 ? static_cast<double>(vertices) / mean_s : 0.0)
+                  << ",\"buffer_bytes\":" << buffers.bytes
+                  << ",\"buffer_high_water_bytes\":" << buffers.high_water_bytes
+                  << ",\"buffer_growths\":" << buffers.growths
+                  << ",\"evaluations\":" << evaluations
+                  << "}" << std::endl;
+    }
+
+    // step() advances what the field is computed from (the particles) before each fill, timed as its
+    // own "evolve" stage so "assign" only covers the fill; nullptr for fields of time alone.
+    // adapt(marcher, t) marches an AdaptiveMarcher over the field, nullptr if it cannot be sampled anywhere
+    template <typename Construct, typename Step, typename Assign, typename Adapt>
+    void runField(const std::string& field, const unsigned int res, const Options& opts, Construct construct, Step step, Assign assign, Adapt adapt)
+    {
+        constexpr bool steps { !std::is_same_v<Step, std::nullptr_t> };
+        StageTimer construct_timer, evolve_timer, assign_timer, march_timer, positions_timer, contour_set_timer, pipeline_timer;
+
+        Clock::time_point start { Clock::now() };
+        Grid grid { construct(res) };
+        construct_timer.add(elapsedMs(start));
+
+        MarchingSquares MSq(opts.isolevel, opts.interp, grid);
+        MSq.setThreads(opts.threads);
+        MSq.setIndexed(opts.indexed);
+        MSq.setPolylines(opts.polylines);
+        MSq.setIncremental(opts.incremental);
+
+        std::vector<float> isolevels;
+        for (unsigned int k = 0; k < opts.levels; ++k)
+        {
+            isolevels.push_back(static_cast<float>(k + 1) / static_cast<float>(opts.levels + 1));
+        }
+        ContourSet contours(isolevels, opts.interp, grid);
+        contours.setThreads(opts.threads);
+        contours.setIsobands(opts.isobands);
+
+        // reused across iterations, as a renderer would: the stage measures the flattening, not the allocation
+        std::vector<float> positions;
+
+        for (unsigned int i = 0; i < opts.iters; ++i)
+        {
+            const float t { static_cast<float>(i) * DT };
+
+            if constexpr (steps)
+            {
+                start = Clock::now();
+                step();
+                evolve_timer.add(elapsedMs(start));
+            }
+
+            start = Clock::now();
+            assign(grid, t);
+            assign_timer.add(elapsedMs(start));
+
+            start = Clock::now();
+            MSq.march(grid);
+            march_timer.add(elapsedMs(start));
+
+            start = Clock::now();
+            MSq.positions(positions);
+            positions_timer.add(elapsedMs(start));
+            sink = positions.empty() ? 0.0f : positions.back();
+
+            if (opts.levels > 0)
+            {
+                start = Clock::now();
+                contours.march(grid);
+                contour_set_timer.add(elapsedMs(start));
+            }
+        }
+
+        const std::size_t vertices { MSq.points().size() };
+        report(field, res, "construct", construct_timer, vertices, opts);
+        if constexpr (steps) { report(field, res, "evolve", evolve_timer, vertices, opts); }
+        report(field, res, "assign", assign_timer, vertices, opts, BufferStats {}, grid.size());
+        report(field, res, "march", march_timer, vertices, opts, MSq.bufferStats());
+        report(field, res, "positions", positions_timer, vertices, opts);
+
+        // whole frames, the next one filled and marched while the current one is
+        // "uploaded" (copied out, as glBufferData would); compare with assign + march + positions
+        if (opts.pipeline)
+        {
+            FramePipeline pipeline([&] { return construct(res); }, opts.isolevel, opts.interp,
+                [&](FramePipeline::Frame& frame)
+                {
+                    frame.marcher.setThreads(opts.threads);
+                    frame.marcher.setIndexed(opts.indexed);
+                    frame.marcher.setPolylines(opts.polylines);
+                    if constexpr (steps) { step(); }
+                    assign(frame.grid, frame.time);
+                });
+            std::vector<float> upload;
+
+            pipeline.submit(0.0f, opts.isolevel);
+            for (unsigned int i = 0; i < opts.iters; ++i)
+            {
+                start = Clock::now();
+                pipeline.submit(static_cast<float>(i + 1) * DT, opts.isolevel);
+                const FramePipeline::Frame* frame { pipeline.acquire() };
+                upload.assign(frame->grid.values().begin(), frame->grid.values().end());
+                upload.insert(upload.end(), frame->positions.begin(), frame->positions.end());
+                pipeline.release();
+                pipeline_timer.add(elapsedMs(start));
+                sink = upload.back();
+            }
+            // drain the frame still in flight
+            pipeline.acquire();
+            pipeline.release();
+
+            report(field, res, "pipeline", pipeline_timer, vertices, opts);
+        }
+
+        // the same field down to the spacing of a Grid of (res - 1) * 2^adaptive + 1 nodes,
+        // sampled only near the contour and where it is curved
+        if constexpr (!std::is_same_v<Adapt, std::nullptr_t>)
+        {
+            if (opts.adaptive > 0)
+            {
+                AdaptiveMarcher adaptive(width, height, res - 1, opts.adaptive, opts.isolevel, opts.interp);
+                StageTimer adaptive_timer;
+                for (unsigned int i = 0; i < opts.iters; ++i)
+                {
+                    start = Clock::now();
+                    adapt(adaptive, static_cast<float>(i) * DT);
+                    adaptive_timer.add(elapsedMs(start));
+                }
+                report(field, res, "adaptive", adaptive_timer, adaptive.points().size(), opts, adaptive.bufferStats(), adaptive.evaluations());
+            }
+        }
+
+        if (opts.levels > 0)
+        {
+            std::size_t contour_vertices { 0 };
+            for (unsigned int k = 0; k < contours.levelCount(); ++k) { contour_vertices += contours.isoline(k).size(); }
+            report(field, res, "contour_set", contour_set_timer, contour_vertices, opts, contours.bufferStats());
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) { return 1; }
+
+    for (const std::string& field : opts.fields)
+    {
+        for (const unsigned int res : opts.resolutions)
+        {
+            if (res < 2)
+            {
+                std::cerr << "resolution must be at least 2\n";
+                return 1;
+            }
+
+            if (field == "perlin")
+            {
+                // same lattice spacing as the stored 10 x 10 lattice
+                PerlinNoise p { opts.octaves > 0 ? PerlinNoise(width / 9, height / 9, 1u) : PerlinNoise(width, height, 10, false) };
+                p.setOctaves(opts.octaves);
+                runField(field, res, opts,
+                    [&](unsigned int r) { return Grid(width, height, r, p); },
+                    nullptr,
+                    [&](Grid& grid, float t) { grid.assignValues(p, t); },
+                    [&](AdaptiveMarcher& adaptive, float t) { adaptive.march(p, t); });
+            }
+            else if (field == "analytic")
+            {
+                runField(field, res, opts,
+                    [&](unsigned int r) { return Grid(width, height, r, f); },
+                    nullptr,
+                    [&](Grid& grid, float t) { grid.assignValues(f, t); },
+                    [&](AdaptiveMarcher& adaptive, float t) { adaptive.march(f, t); });
+            }
+            else if (field == "metaball")
+            {
+                Particles particles { makeParticles(opts.particles) };
+                particles.setThreads(opts.threads);
+                particles.setCollisions(opts.collide);
+                runField(field, res, opts,
+                    [&](unsigned int r) { return Grid(width, height, r, true, particles); },
+                    [&] { particles.evolve(width, height, DT); },
+                    [&](Grid& grid, float) {
+                        if (opts.cutoff > 0.0f) { grid.assignValues(particles, opts.cutoff, opts.compact ? Falloff::Compact : Falloff::Inverse); }
+                        else { grid.assignValues(particles); }
+                    },
+                    nullptr);
+            }
+            else
+            {
+                std::cerr << "unknown field: " << field << '\n';
+                return 1;
+            }
+        }
+    }
+
+    if (!opts.trace.empty())
+    {
+#ifdef MS_PROFILE
+        if (!Profiler::instance().writeChromeTrace(opts.trace)) { return 1; }
+        Profiler::instance().writeSummary(std::cerr);
+#else
+        std::cerr << "--trace needs a PROFILE=1 build\n";
+#endif
+    }
+
+    return 0;
+}
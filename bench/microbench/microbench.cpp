@@ -0,0 +1,485 @@
+// Microbenchmarks of the contouring kernels, kept as JSON baselines.
+//
+// usage: microbench [--res 250,1000] [--samples N] [--min-ms M] [--filter TEXT] [--out FILE]
+//        microbench --compare BASE.json NEW.json [--threshold PCT] [--alpha P]
+//
+// Covers PerlinNoise::noise, every Grid::assignValues overload, MarchingSquares::march
+// with and without interpolation, and positions(), swept over resolution, isolevel and
+// field: smooth (hashed) Perlin noise, a high frequency analytic field, metaballs and
+// white noise, the worst case for the march (about every other cell is crossed).
+// Every grid's field is seeded, so two builds time the same work.
+//
+// Each benchmark takes N samples, in N rounds over all benchmarks; a sample repeats the
+// operation until it has run for at least M ms and records the time per item (per noise call, per grid node, per
+// position float). The samples of every benchmark are written as one JSON document, to FILE
+// or stdout, to be kept as a baseline.
+//
+// --compare reads two such documents and prints one JSON object per benchmark. A
+// benchmark is "slower" when its median time grew by more than PCT percent (default 5)
+// and a one-sided Mann-Whitney U test on the two sample sets rejects "not slower" at
+// level P (default 0.01); "faster" likewise. The exit status is 2 if any benchmark
+// got slower, 1 on errors.
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Grid/Grid.hpp"
+#include "MarchingSquares/MarchingSquares.hpp"
+#include "Particle/Particle.hpp"
+#include "PerlinNoise/PerlinNoise.hpp"
+
+namespace
+{
+    const float width { 768.0f };
+    const float height { 768.0f };
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Options
+    {
+        std::vector<unsigned int> resolutions { 250, 1000 };
+        unsigned int samples { 15 };
+        double min_ms { 5.0 };
+        std::string filter {};
+        std::string out {};
+        // comparison mode
+        std::string base {};
+        std::string head {};
+        double threshold { 5.0 }; // percent
+        double alpha { 0.01 };
+    };
+
+    // a benchmark read back from a baseline
+    struct Result
+    {
+        std::string name;
+        std::vector<double> samples; // ns per item
+    };
+
+    // keeps the benchmarked results observable to the optimizer
+    volatile float sink { 0.0f };
+
+    // high frequency analytic field, a few cells per period at the coarsest resolution
+    float ripple(const glm::vec2& v, const float t)
+    {
+        const float k { 96.0f / width };
+        return (std::sin(k * v.x + t) * std::cos(k * v.y - 0.5f * t) + 1.0f) / 2.0f;
+    }
+
+    // white noise in [0, 1), a hash of the position bits
+    float whiteNoise(const glm::vec2& v)
+    {
+        std::uint32_t h { std::bit_cast<std::uint32_t>(v.x) * 0x9e3779b1u ^ std::bit_cast<std::uint32_t>(v.y) * 0x85ebca77u };
+        h ^= h >> 15;
+        h *= 0x2c1b3c6du;
+        h ^= h >> 12;
+        return static_cast<float>(h >> 8) / 16777216.0f;
+    }
+
+    std::vector<Particle> makeParticles(const unsigned int count)
+    {
+        std::mt19937 rng { 1234 };
+        std::uniform_real_distribution<float> radius_dist(2.0f, 12.0f);
+        std::uniform_real_distribution<float> x_dist(0.0f, width);
+        std::uniform_real_distribution<float> y_dist(0.0f, height);
+        std::vector<Particle> particles;
+        particles.reserve(count);
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            particles.emplace_back(radius_dist(rng), glm::vec2(x_dist(rng), y_dist(rng)), glm::vec2(0.0f, 0.0f));
+        }
+        return particles;
+    }
+
+    double median(std::vector<double> samples)
+    {
+        if (samples.empty()) { return 0.0; }
+        const std::size_t mid { samples.size() / 2 };
+        std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(mid), samples.end());
+        if (samples.size() % 2) { return samples[mid]; }
+        return (samples[mid] + *std::max_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(mid))) / 2.0;
+    }
+
+    class Suite
+    {
+    private:
+        struct Benchmark
+        {
+            std::string name;
+            const char* unit;
+            std::size_t items;
+            std::function<void()> op;
+            unsigned int repeats;
+            std::vector<double> samples;
+        };
+
+        const Options& m_opts;
+        std::vector<Benchmark> m_benchmarks;
+
+    public:
+        explicit Suite(const Options& opts)
+            : m_opts { opts }
+            , m_benchmarks {}
+        {}
+
+        // op() handles `items` items; whatever it references must live until run() returns
+        void add(const std::string& name, const char* unit, const std::size_t items, std::function<void()> op)
+        {
+            if (items == 0 || (!m_opts.filter.empty() && name.find(m_opts.filter) == std::string::npos)) { return; }
+            m_benchmarks.push_back({ name, unit, items, std::move(op), 1, {} });
+        }
+
+        void run()
+        {
+            // warm up, then pick repeat counts that fill min_ms
+            for (Benchmark& benchmark : m_benchmarks)
+            {
+                const Clock::time_point start { Clock::now() };
+                benchmark.op();
+                const double once_ms { std::chrono::duration<double, std::milli>(Clock::now() - start).count() };
+                benchmark.repeats = std::max(1u, static_cast<unsigned int>(std::ceil(m_opts.min_ms / std::max(once_ms, 1e-6))));
+            }
+
+            // one sample of every benchmark per round, so drift over the run (clocks, other
+            // load) spreads into every benchmark's samples instead of shifting some of them
+            for (unsigned int s = 0; s < m_opts.samples; ++s)
+            {
+                for (Benchmark& benchmark : m_benchmarks)
+                {
+                    const Clock::time_point start { Clock::now() };
+                    for (unsigned int r = 0; r < benchmark.repeats; ++r) { benchmark.op(); }
+                    const double ns { std::chrono::duration<double, std::nano>(Clock::now() - start).count() };
+                    benchmark.samples.push_back(ns / (static_cast<double>(benchmark.repeats) * static_cast<double>(benchmark.items)));
+                }
+            }
+
+            for (const Benchmark& benchmark : m_benchmarks)
+            {
+                std::cerr << benchmark.name << ": " << median(benchmark.samples) << " ns/" << benchmark.unit << '\n';
+            }
+        }
+
+        void write(std::ostream& out) const
+        {
+            out << "{\"suite\":\"microbench\",\"benchmarks\":[\n";
+            for (std::size_t i = 0; i < m_benchmarks.size(); ++i)
+            {
+                const Benchmark& benchmark { m_benchmarks[i] };
+                const std::vector<double>& s { benchmark.samples };
+                double mean { 0.0 };
+                for (const double x : s) { mean += x; }
+                mean /= static_cast<double>(s.size());
+
+                out << "{\"name\":\"" << benchmark.name << "\",\"unit\":\"ns/" << benchmark.unit << "\""
+                    << ",\"median\":" << median(s)
+                    << ",\"mean\":" << mean
+                    << ",\"min\":" << *std::min_element(s.begin(), s.end())
+                    << ",\"samples\":[";
+                for (std::size_t k = 0; k < s.size(); ++k) { out << (k ? "," : "") << s[k]; }
+                out << "]}" << (i + 1 < m_benchmarks.size() ? ",\n" : "\n");
+            }
+            out << "]}\n";
+        }
+    };
+
+    // the same scattered points for every noise mode
+    struct NoiseScene
+    {
+        PerlinNoise stored { width, height, 10, false };
+        PerlinNoise hashed { width / 9, height / 9, 1u };
+        PerlinNoise octaves { width / 9, height / 9, 1u };
+        std::vector<glm::vec2> points {};
+
+        NoiseScene()
+        {
+            octaves.setOctaves(4);
+            std::mt19937 rng { 42 };
+            std::uniform_real_distribution<float> coord(0.0f, width);
+            points.resize(4096);
+            for (glm::vec2& point : points) { point = { coord(rng), coord(rng) }; }
+        }
+
+        void add(Suite& suite) const
+        {
+            auto noiseAt = [this](const PerlinNoise& p)
+            {
+                return [this, &p]
+                {
+                    float sum { 0.0f };
+                    for (const glm::vec2& point : points) { sum += p.noise(point, 0.3f); }
+                    sink = sum;
+                };
+            };
+            suite.add("noise/stored", "call", points.size(), noiseAt(stored));
+            suite.add("noise/hashed", "call", points.size(), noiseAt(hashed));
+            suite.add("noise/hashed_octaves=4", "call", points.size(), noiseAt(octaves));
+        }
+    };
+
+    // the grids and marchers of one resolution
+    struct Scene
+    {
+        static constexpr float cutoff { 60.0f };
+
+        unsigned int res;
+        PerlinNoise perlin { width / 9, height / 9, 1u };
+        // a few particles for the exact sums, which visit every node per particle; many for the cutoff fills
+        std::vector<Particle> few_vector { makeParticles(5) };
+        std::vector<Particle> many_vector { makeParticles(300) };
+        Particles few { few_vector };
+        Particles many { many_vector };
+
+        Grid perlin_grid { width, height, res, perlin };
+        Grid ripple_grid { width, height, res, ripple };
+        Grid metaball_grid { width, height, res, true, few };
+        Grid noise_grid { width, height, res, whiteNoise };
+        Grid scratch { width, height, res, whiteNoise };
+
+        std::deque<MarchingSquares> marchers {};
+        std::vector<float> positions {};
+
+        explicit Scene(const unsigned int resolution)
+            : res { resolution }
+        {
+            metaball_grid.assignValues(many, cutoff);
+        }
+
+        void add(Suite& suite)
+        {
+            const std::string r { "/res=" + std::to_string(res) };
+            const std::size_t nodes { static_cast<std::size_t>(res) * res };
+
+            // every overload, into the scratch grid
+            suite.add("assign/function" + r, "node", nodes, [this] { scratch.assignValues(whiteNoise); });
+            suite.add("assign/function_t" + r, "node", nodes, [this] { scratch.assignValues(ripple, 0.3f); });
+            suite.add("assign/perlin" + r, "node", nodes, [this] { scratch.assignValues(perlin, 0.3f); });
+            suite.add("assign/particle_vector" + r, "node", nodes, [this] { scratch.assignValues(few_vector); });
+            suite.add("assign/particle_vector_cutoff" + r, "node", nodes, [this] { scratch.assignValues(many_vector, cutoff); });
+            suite.add("assign/particles" + r, "node", nodes, [this] { scratch.assignValues(few); });
+            suite.add("assign/particles_cutoff" + r, "node", nodes, [this] { scratch.assignValues(many, cutoff); });
+
+            const std::pair<const char*, const Grid*> fields[] {
+                { "perlin", &perlin_grid }, { "ripple", &ripple_grid }, { "metaball", &metaball_grid }, { "noise", &noise_grid }
+            };
+            for (const auto& [field, grid] : fields)
+            {
+                for (const float isolevel : { 0.25f, 0.5f, 0.75f })
+                {
+                    for (const bool interp : { true, false })
+                    {
+                        std::ostringstream name;
+                        name << "march/" << field << r << "/iso=" << isolevel << "/interp=" << interp;
+                        MarchingSquares& marcher { marchers.emplace_back(isolevel, interp, *grid) };
+                        suite.add(name.str(), "node", nodes, [&marcher, grid] { marcher.march(*grid); });
+
+                        // flattening, with a reused buffer as a renderer would
+                        if (isolevel == 0.5f && interp)
+                        {
+                            suite.add(std::string("positions/") + field + r, "float", marcher.positionCount(),
+                                      [this, &marcher] { marcher.positions(positions); sink = positions.back(); });
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    // position just past `"key":` (whitespace allowed around the colon) at or after `pos`, npos if none
+    std::size_t findKey(const std::string& text, const std::string& key, std::size_t pos)
+    {
+        const std::string quoted { '"' + key + '"' };
+        while ((pos = text.find(quoted, pos)) != std::string::npos)
+        {
+            pos = text.find_first_not_of(" \t\r\n", pos + quoted.size());
+            if (pos != std::string::npos && text[pos] == ':') { return text.find_first_not_of(" \t\r\n", pos + 1); }
+        }
+        return std::string::npos;
+    }
+
+    // the name and samples of every benchmark in a document written by Suite::write
+    bool readBaseline(const std::string& path, std::vector<Result>& results)
+    {
+        std::ifstream file { path };
+        if (!file)
+        {
+            std::cerr << "cannot open " << path << '\n';
+            return false;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        const std::string text { buffer.str() };
+
+        std::size_t pos { 0 };
+        while ((pos = findKey(text, "name", pos)) != std::string::npos && text[pos] == '"')
+        {
+            const std::size_t name_end { text.find('"', pos + 1) };
+            const std::size_t samples { findKey(text, "samples", name_end) };
+            if (name_end == std::string::npos || samples == std::string::npos || text[samples] != '[') { break; }
+
+            Result result { text.substr(pos + 1, name_end - pos - 1), {} };
+            const char* c { text.c_str() + samples + 1 };
+            while (*c && *c != ']')
+            {
+                char* next { nullptr };
+                result.samples.push_back(std::strtod(c, &next));
+                if (next == c) { break; }
+                c = next;
+                while (*c == ',' || *c == ' ' || *c == '\n') { ++c; }
+            }
+            pos = static_cast<std::size_t>(c - text.c_str());
+            results.push_back(std::move(result));
+        }
+
+        if (results.empty())
+        {
+            std::cerr << path << " holds no benchmarks\n";
+            return false;
+        }
+        return true;
+    }
+
+    // one-sided Mann-Whitney U test: probability of a U at least this large if `b` is not
+    // stochastically larger than `a`; normal approximation with continuity correction
+    double mannWhitneyGreater(const std::vector<double>& a, const std::vector<double>& b)
+    {
+        double u { 0.0 };
+        for (const double y : b)
+        {
+            for (const double x : a) { u += y > x ? 1.0 : (y == x ? 0.5 : 0.0); }
+        }
+        const double n1 { static_cast<double>(a.size()) };
+        const double n2 { static_cast<double>(b.size()) };
+        const double sigma { std::sqrt(n1 * n2 * (n1 + n2 + 1.0) / 12.0) };
+        if (sigma == 0.0) { return 1.0; }
+        const double z { (u - n1 * n2 / 2.0 - 0.5) / sigma };
+        return 0.5 * std::erfc(z / std::sqrt(2.0));
+    }
+
+    int compare(const Options& opts)
+    {
+        std::vector<Result> base, head;
+        if (!readBaseline(opts.base, base) || !readBaseline(opts.head, head)) { return 1; }
+
+        unsigned int slower { 0 }, faster { 0 };
+        for (const Result& now : head)
+        {
+            const auto before { std::find_if(base.begin(), base.end(), [&](const Result& r) { return r.name == now.name; }) };
+            if (before == base.end())
+            {
+                std::cout << "{\"name\":\"" << now.name << "\",\"verdict\":\"new\"}" << std::endl;
+                continue;
+            }
+
+            const double ratio { median(now.samples) / median(before->samples) };
+            const double p_slower { mannWhitneyGreater(before->samples, now.samples) };
+            const double p_faster { mannWhitneyGreater(now.samples, before->samples) };
+            const char* verdict { "same" };
+            if (ratio > 1.0 + opts.threshold / 100.0 && p_slower < opts.alpha) { verdict = "slower"; ++slower; }
+            else if (ratio < 1.0 - opts.threshold / 100.0 && p_faster < opts.alpha) { verdict = "faster"; ++faster; }
+
+            std::cout << "{\"name\":\"" << now.name << "\""
+                      << ",\"base_median\":" << median(before->samples)
+                      << ",\"median\":" << median(now.samples)
+                      << ",\"ratio\":" << ratio
+                      << ",\"p\":" << std::min(p_slower, p_faster)
+                      << ",\"verdict\":\"" << verdict << "\"}" << std::endl;
+        }
+        for (const Result& before : base)
+        {
+            if (std::none_of(head.begin(), head.end(), [&](const Result& r) { return r.name == before.name; }))
+            {
+                std::cout << "{\"name\":\"" << before.name << "\",\"verdict\":\"missing\"}" << std::endl;
+            }
+        }
+
+        std::cerr << slower << " slower, " << faster << " faster of " << head.size() << '\n';
+        return slower > 0 ? 2 : 0;
+    }
+
+    bool parseArgs(int argc, char** argv, Options& opts)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const char* arg { argv[i] };
+            const bool hasValue { i + 1 < argc };
+
+            if (!std::strcmp(arg, "--res") && hasValue)
+            {
+                opts.resolutions.clear();
+                std::stringstream list { argv[++i] };
+                std::string item;
+                while (std::getline(list, item, ','))
+                {
+                    if (!item.empty()) { opts.resolutions.push_back(static_cast<unsigned int>(std::stoul(item))); }
+                }
+            }
+            else if (!std::strcmp(arg, "--samples") && hasValue) { opts.samples = static_cast<unsigned int>(std::stoul(argv[++i])); }
+            else if (!std::strcmp(arg, "--min-ms") && hasValue) { opts.min_ms = std::stod(argv[++i]); }
+            else if (!std::strcmp(arg, "--filter") && hasValue) { opts.filter = argv[++i]; }
+            else if (!std::strcmp(arg, "--out") && hasValue) { opts.out = argv[++i]; }
+            else if (!std::strcmp(arg, "--compare") && i + 2 < argc)
+            {
+                opts.base = argv[++i];
+                opts.head = argv[++i];
+            }
+            else if (!std::strcmp(arg, "--threshold") && hasValue) { opts.threshold = std::stod(argv[++i]); }
+            else if (!std::strcmp(arg, "--alpha") && hasValue) { opts.alpha = std::stod(argv[++i]); }
+            else
+            {
+                std::cerr << "usage: " << argv[0] << " [--res 250,1000] [--samples N] [--min-ms M] [--filter TEXT] [--out FILE]\n"
+                          << "       " << argv[0] << " --compare BASE.json NEW.json [--threshold PCT] [--alpha P]\n";
+                return false;
+            }
+        }
+        return opts.samples > 1;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) { return 1; }
+    if (!opts.base.empty()) { return compare(opts); }
+
+    Suite suite { opts };
+    NoiseScene noise;
+    noise.add(suite);
+    std::deque<Scene> scenes;
+    for (const unsigned int res : opts.resolutions)
+    {
+        if (res < 2)
+        {
+            std::cerr << "resolution must be at least 2\n";
+            return 1;
+        }
+        scenes.emplace_back(res).add(suite);
+    }
+    suite.run();
+
+    if (opts.out.empty())
+    {
+        suite.write(std::cout);
+        return 0;
+    }
+    std::ofstream file { opts.out };
+    if (!file)
+    {
+        std::cerr << "cannot open " << opts.out << '\n';
+        return 1;
+    }
+    suite.write(file);
+    return file ? 0 : 1;
+}
@@ -0,0 +1,281 @@
+#include "AdaptiveMarcher.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "../MarchingSquares/MarchingSquares.hpp"
+
+AdaptiveMarcher::AdaptiveMarcher(const float width, const float height, const unsigned int base_cells, const unsigned int max_depth,
+                                 const float isolevel, const bool interp)
+    : m_base_x { std::max(base_cells, 1u) }
+    , m_base_y { 1 }
+    , m_max_depth { max_depth }
+    , m_isolevel { isolevel }
+    , m_interp { interp }
+    , m_cell_size { 1 }
+    , m_spacing { 0.0f }
+    , m_nodes {}
+    , m_leaves {}
+    , m_ring {}
+    , m_ring_crossings {}
+    , m_points {}
+    , m_buffers {}
+{
+    // node coordinates are 32 bit, with room to spare for the far edge
+    while (m_max_depth > 0 && (static_cast<std::uint64_t>(m_base_x) << m_max_depth) >= (1u << 30))
+    {
+        --m_max_depth;
+    }
+    if (m_max_depth != max_depth)
+    {
+        std::cerr << "AdaptiveMarcher: max_depth reduced to " << m_max_depth << '\n';
+    }
+
+    // the same spacing as Grid::dx() of a width wide Grid with equivalentResolution() nodes
+    m_cell_size = 1u << m_max_depth;
+    m_spacing = width / static_cast<float>(m_base_x * m_cell_size);
+    m_base_y = std::max(1u, static_cast<unsigned int>(std::ceil(height / (m_spacing * static_cast<float>(m_cell_size)))));
+}
+
+void AdaptiveMarcher::march(float (*f)(const glm::vec2&))
+{
+    build([f](const glm::vec2& position) { return f(position); });
+}
+
+void AdaptiveMarcher::march(float (*f)(const glm::vec2&, const float), const float t)
+{
+    build([f, t](const glm::vec2& position) { return f(position, t); });
+}
+
+void AdaptiveMarcher::march(const PerlinNoise& perlin, const float t)
+{
+    build([&perlin, t](const glm::vec2& position) { return perlin.noise(position, t); });
+}
+
+template <typename Field>
+void AdaptiveMarcher::build(const Field& field)
+{
+    clear();
+
+    for (unsigned int y_b = 0; y_b < m_base_y; ++y_b)
+    {
+        for (unsigned int x_b = 0; x_b < m_base_x; ++x_b)
+        {
+            const unsigned int x_i { x_b * m_cell_size };
+            const unsigned int y_i { y_b * m_cell_size };
+            const unsigned int size { m_cell_size };
+            refine(field, x_i, y_i, size, 0, value(field, x_i, y_i), value(field, x_i + size, y_i),
+                   value(field, x_i, y_i + size), value(field, x_i + size, y_i + size));
+        }
+    }
+
+    // every leaf corner is known now, so each leaf can see the smaller neighbours along its edges
+    for (const Leaf& leaf : m_leaves) { marchLeaf(leaf); }
+
+    m_buffers.add(m_nodes);
+    m_buffers.add(m_leaves);
+    m_buffers.add(m_ring);
+    m_buffers.add(m_ring_crossings);
+    m_buffers.add(m_points);
+    m_buffers.finish();
+}
+
+template <typename Field>
+void AdaptiveMarcher::refine(const Field& field, const unsigned int x_i, const unsigned int y_i, const unsigned int size, const unsigned int depth,
+                             const float nw, const float ne, const float sw, const float se)
+{
+    if (depth < m_max_depth)
+    {
+        // the children's new corners, so a split costs no extra evaluations
+        const unsigned int half { size / 2 };
+        const float n { value(field, x_i + half, y_i) };
+        const float s { value(field, x_i + half, y_i + size) };
+        const float w { value(field, x_i, y_i + half) };
+        const float e { value(field, x_i + size, y_i + half) };
+        const float c { evaluate(field, x_i + half, y_i + half) };
+
+        const bool side { active(nw) };
+        const bool straddles { active(ne) != side || active(sw) != side || active(se) != side
+            || active(n) != side || active(s) != side || active(w) != side || active(e) != side || active(c) != side };
+        const bool curved { std::abs(c - (nw + ne + sw + se) / 4) > m_tolerance
+            || std::abs(n - (nw + ne) / 2) > m_tolerance || std::abs(s - (sw + se) / 2) > m_tolerance
+            || std::abs(w - (nw + sw) / 2) > m_tolerance || std::abs(e - (ne + se) / 2) > m_tolerance };
+
+        if (straddles || curved)
+        {
+            refine(field, x_i, y_i, half, depth + 1, nw, n, w, c);
+            refine(field, x_i + half, y_i, half, depth + 1, n, ne, c, e);
+            refine(field, x_i, y_i + half, half, depth + 1, w, c, sw, s);
+            refine(field, x_i + half, y_i + half, half, depth + 1, c, e, s, se);
+            return;
+        }
+    }
+
+    m_leaves.push_back({ x_i, y_i, size, nw, ne, sw, se });
+    markCorner(x_i, y_i);
+    markCorner(x_i + size, y_i);
+    markCorner(x_i, y_i + size);
+    markCorner(x_i + size, y_i + size);
+}
+
+template <typename Field>
+float AdaptiveMarcher::value(const Field& field, const unsigned int x_i, const unsigned int y_i)
+{
+    const std::uint64_t node_key { key(x_i, y_i) };
+    Node* node { &slot(node_key) };
+    if (node->key == node_key) { return node->value; }
+
+    if (2 * (m_node_count + 1) > m_nodes.size())
+    {
+        grow();
+        node = &slot(node_key);
+    }
+    *node = { node_key, evaluate(field, x_i, y_i), false };
+    ++m_node_count;
+    return node->value;
+}
+
+template <typename Field>
+float AdaptiveMarcher::evaluate(const Field& field, const unsigned int x_i, const unsigned int y_i)
+{
+    ++m_evaluations;
+    return static_cast<float>(field(glm::vec2(x(x_i), y(y_i))));
+}
+
+void AdaptiveMarcher::markCorner(const unsigned int x_i, const unsigned int y_i)
+{
+    // a corner that is not stored is some cell's centre, which no leaf edge passes through
+    Node& node { slot(key(x_i, y_i)) };
+    if (node.key != empty_key) { node.corner = true; }
+}
+
+AdaptiveMarcher::Node& AdaptiveMarcher::slot(const std::uint64_t node_key)
+{
+    // fibonacci hashing; the table is never more than half full, so probes stay short
+    const std::size_t mask { m_nodes.size() - 1 };
+    std::size_t i { static_cast<std::size_t>((node_key * 0x9e3779b97f4a7c15ull) >> 32) & mask };
+    while (m_nodes[i].key != node_key && m_nodes[i].key != empty_key) { i = (i + 1) & mask; }
+    return m_nodes[i];
+}
+
+void AdaptiveMarcher::grow()
+{
+    std::vector<Node> old;
+    old.swap(m_nodes);
+    m_nodes.assign(std::max<std::size_t>(1024, 2 * old.size()), Node { empty_key, 0.0f, false });
+    for (const Node& node : old)
+    {
+        if (node.key != empty_key) { slot(node.key) = node; }
+    }
+}
+
+void AdaptiveMarcher::appendHanging(const unsigned int x0, const unsigned int y0, const unsigned int x1, const unsigned int y1)
+{
+    // smaller neighbours are aligned to the quadtree, so if any leaf corner lies inside
+    // the edge its midpoint is one
+    const unsigned int length { std::max(x0, x1) - std::min(x0, x1) + std::max(y0, y1) - std::min(y0, y1) };
+    if (length < 2) { return; }
+
+    const unsigned int x_m { (x0 + x1) / 2 };
+    const unsigned int y_m { (y0 + y1) / 2 };
+    const Node& node { slot(key(x_m, y_m)) };
+    if (!node.corner) { return; }
+    const float value { node.value };
+
+    appendHanging(x0, y0, x_m, y_m);
+    m_ring.push_back({ x_m, y_m, value });
+    appendHanging(x_m, y_m, x1, y1);
+}
+
+void AdaptiveMarcher::marchLeaf(const Leaf& leaf)
+{
+    const unsigned int x0 { leaf.x };
+    const unsigned int y0 { leaf.y };
+    const unsigned int x1 { leaf.x + leaf.size };
+    const unsigned int y1 { leaf.y + leaf.size };
+
+    // corners and hanging nodes, clockwise from nw
+    m_ring.clear();
+    m_ring.push_back({ x0, y0, leaf.nw });
+    appendHanging(x0, y0, x1, y0);
+    m_ring.push_back({ x1, y0, leaf.ne });
+    appendHanging(x1, y0, x1, y1);
+    m_ring.push_back({ x1, y1, leaf.se });
+    appendHanging(x1, y1, x0, y1);
+    m_ring.push_back({ x0, y1, leaf.sw });
+    appendHanging(x0, y1, x0, y0);
+
+    // ring edges with a crossing; they alternate between leaving and entering the active region
+    const unsigned int count { static_cast<unsigned int>(m_ring.size()) };
+    m_ring_crossings.clear();
+    unsigned int first_exit { count };
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const bool from { active(m_ring[i].value) };
+        if (from == active(m_ring[(i + 1) % count].value)) { continue; }
+        if (from && first_exit == count) { first_exit = static_cast<unsigned int>(m_ring_crossings.size()); }
+        m_ring_crossings.push_back(i);
+    }
+    if (m_ring_crossings.empty()) { return; }
+
+    // join each exit with the following entry, cutting off every run of inactive nodes
+    const unsigned int crossings { static_cast<unsigned int>(m_ring_crossings.size()) };
+    for (unsigned int k = 0; k < crossings; k += 2)
+    {
+        const unsigned int exit { m_ring_crossings[(first_exit + k) % crossings] };
+        const unsigned int entry { m_ring_crossings[(first_exit + k + 1) % crossings] };
+        m_points.push_back(crossing(m_ring[exit], m_ring[(exit + 1) % count]));
+        m_points.push_back(crossing(m_ring[entry], m_ring[(entry + 1) % count]));
+    }
+}
+
+Point AdaptiveMarcher::crossing(const RingNode& a, const RingNode& b) const
+{
+    // measured from the active end, so the leaves on either side of an edge agree to the bit
+    const RingNode& on { active(a.value) ? a : b };
+    const RingNode& off { active(a.value) ? b : a };
+    const bool horizontal { on.y == off.y };
+    const float on_x { x(on.x) };
+    const float on_y { y(on.y) };
+    const float off_pos { horizontal ? x(off.x) : y(off.y) };
+
+    const float pos { edgeCrossing(horizontal ? on_x : on_y, off_pos, on.value, off.value, m_isolevel, m_interp) };
+    return horizontal ? Point(pos, on_y) : Point(on_x, pos);
+}
+
+std::vector<float> AdaptiveMarcher::positions() const
+{
+    std::vector<float> positions;
+    this->positions(positions);
+    return positions;
+}
+
+std::size_t AdaptiveMarcher::writePositions(const std::span<float> out) const
+{
+    const std::size_t count { positionCount() };
+    if (out.size() < count) { return count; }
+
+    float* dst { out.data() };
+    for (const Point& point : m_points)
+    {
+        *dst++ = point.position().x;
+        *dst++ = point.position().y;
+    }
+
+    return count;
+}
+
+void AdaptiveMarcher::positions(std::vector<float>& out) const
+{
+    out.resize(positionCount());
+    writePositions(out);
+}
+
+void AdaptiveMarcher::clear()
+{
+    if (m_nodes.empty()) { grow(); }
+    std::fill(m_nodes.begin(), m_nodes.end(), Node { empty_key, 0.0f, false });
+    m_node_count = 0;
+    m_evaluations = 0;
+    m_leaves.clear();
+    m_points.clear();
+}
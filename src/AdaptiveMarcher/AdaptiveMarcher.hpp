@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "../Point/Point.hpp"
+#include "../PerlinNoise/PerlinNoise.hpp"
+#include "../BufferStats/BufferStats.hpp"
+
+// Isolines of a field that can be evaluated anywhere, on a quadtree instead of
+// a uniform Grid. The domain starts as square cells base_cells across; a cell
+// is split while any of its corner, edge midpoint and centre samples lie on
+// different sides of the isolevel, or the centre or a midpoint strays more than
+// the tolerance from the bilinear estimate, down to max_depth splits. The
+// finest cells have the spacing of a Grid (base_cells << max_depth) + 1 nodes
+// across, and a contour through them is the same one that Grid would give.
+//
+// Cells of different sizes meet without cracks: each leaf is marched as the
+// polygon of its corners plus the corners of smaller neighbours on its edges,
+// so both sides of an edge split it at the same nodes and compute the same
+// crossings. Crossings around a leaf are paired so that every run of inactive
+// boundary nodes is cut off, i.e. saddles join the active corners
+// (SaddlePolicy::Active).
+class AdaptiveMarcher
+{
+private:
+    unsigned int m_base_x;
+    unsigned int m_base_y;
+    unsigned int m_max_depth;
+    float m_isolevel;
+    bool m_interp;
+    float m_tolerance { 0.02f };
+
+    // lattice of the finest cells: node (x_i, y_i) sits at (x_i * m_spacing, y_i * m_spacing)
+    unsigned int m_cell_size; // finest cells per base cell
+    float m_spacing;
+
+    // nodes a cell shares with its neighbours (base nodes and edge midpoints), open
+    // addressed by (y_i << 32 | x_i); `corner` marks those that are a corner of some
+    // leaf. Cell centres are only seen by the cell's own children, which are handed
+    // the value, and can never lie inside a leaf edge, so they are not stored
+    struct Node
+    {
+        std::uint64_t key;
+        float value;
+        bool corner;
+    };
+    static constexpr std::uint64_t empty_key { ~std::uint64_t { 0 } };
+    std::vector<Node> m_nodes;
+    std::size_t m_node_count { 0 };
+    std::size_t m_evaluations { 0 };
+
+    struct Leaf
+    {
+        unsigned int x, y, size; // nw node and side, in finest cells
+        float nw, ne, sw, se;
+    };
+    std::vector<Leaf> m_leaves;
+
+    // the boundary of the leaf being marched, nodes in order around it
+    struct RingNode
+    {
+        unsigned int x, y;
+        float value;
+    };
+    std::vector<RingNode> m_ring;
+    std::vector<unsigned int> m_ring_crossings;
+
+    std::vector<Point> m_points;
+
+    BufferTracker m_buffers;
+
+    bool active(const float value) const { return !(value < m_isolevel); }
+    float x(const unsigned int x_i) const { return static_cast<float>(x_i) * m_spacing; }
+    float y(const unsigned int y_i) const { return static_cast<float>(y_i) * m_spacing; }
+
+    static std::uint64_t key(const unsigned int x_i, const unsigned int y_i)
+    {
+        return static_cast<std::uint64_t>(y_i) << 32 | x_i;
+    }
+    // slot holding the node, or the empty slot it would go in
+    Node& slot(const std::uint64_t node_key);
+    void grow();
+    // the stored node's value, evaluated and stored first if new
+    template <typename Field>
+    float value(const Field& field, const unsigned int x_i, const unsigned int y_i);
+    template <typename Field>
+    float evaluate(const Field& field, const unsigned int x_i, const unsigned int y_i);
+    void markCorner(const unsigned int x_i, const unsigned int y_i);
+
+    template <typename Field>
+    void build(const Field& field);
+    template <typename Field>
+    void refine(const Field& field, const unsigned int x_i, const unsigned int y_i, const unsigned int size, const unsigned int depth,
+                const float nw, const float ne, const float sw, const float se);
+    // appends the leaf corners strictly between the two ends of an axis aligned leaf edge, in order
+    void appendHanging(const unsigned int x0, const unsigned int y0, const unsigned int x1, const unsigned int y1);
+    void marchLeaf(const Leaf& leaf);
+    Point crossing(const RingNode& a, const RingNode& b) const;
+
+public:
+    // the domain is [0, width] x [0, height] rounded up to whole base cells, base_cells across
+    AdaptiveMarcher(const float width, const float height, const unsigned int base_cells, const unsigned int max_depth,
+                    const float isolevel, const bool interp);
+
+    void march(float (*f)(const glm::vec2&));
+    void march(float (*f)(const glm::vec2&, const float), const float t);
+    void march(const PerlinNoise& perlin, const float t);
+
+    // segment endpoint pairs, as MarchingSquares::points()
+    const std::vector<Point>& points() const { return m_points; }
+    std::vector<float> positions() const;
+    std::size_t positionCount() const { return 2 * m_points.size(); }
+    // as MarchingSquares::writePositions
+    std::size_t writePositions(std::span<float> out) const;
+    void positions(std::vector<float>& out) const;
+
+    // distinct nodes the field was evaluated at by the last march, and the leaves it produced
+    std::size_t evaluations() const { return m_evaluations; }
+    std::size_t leafCount() const { return m_leaves.size(); }
+    // nodes across the uniform Grid whose finest spacing this matches
+    unsigned int equivalentResolution() const { return m_base_x * m_cell_size + 1; }
+
+    float getIsolevel() const { return m_isolevel; }
+    void setIsolevel(const float isolevel) { m_isolevel = isolevel; }
+    // largest deviation from bilinear (in field units) a cell may show at its centre and edge midpoints and stay whole
+    float tolerance() const { return m_tolerance; }
+    void setTolerance(const float tolerance) { m_tolerance = tolerance; }
+    unsigned int maxDepth() const { return m_max_depth; }
+
+    const BufferStats& bufferStats() const { return m_buffers.stats(); }
+    void clear();
+};
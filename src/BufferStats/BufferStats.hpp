@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../Profiler/Profiler.hpp"
+
+// Memory held by the buffers an object reuses from frame to frame. Those
+// buffers are cleared, never shrunk, so each keeps the capacity of the largest
+// frame it has seen and a frame only allocates when some buffer outgrows that.
+struct BufferStats
+{
+    std::size_t bytes { 0 };            // capacity held after the last frame
+    std::size_t high_water_bytes { 0 }; // most ever held after a frame
+    std::uint64_t frames { 0 };
+    // buffers that had to grow (reallocate, one or more times) during the last frame / all frames
+    std::uint64_t frame_growths { 0 };
+    std::uint64_t growths { 0 };
+};
+
+// Builds BufferStats by comparing every buffer's capacity with the one it had
+// at the end of the previous frame. Buffers must be added in the same order
+// each frame; a changed buffer count (e.g. another thread count) shows up as
+// growths once.
+class BufferTracker
+{
+private:
+    std::vector<std::size_t> m_capacities {}; // bytes per buffer, in add() order, as of the last frame
+    std::size_t m_next { 0 };
+    std::size_t m_bytes { 0 };
+    std::uint64_t m_frame_growths { 0 };
+    BufferStats m_stats {};
+
+public:
+    template <typename Vector>
+    void add(const Vector& buffer)
+    {
+        const std::size_t bytes { buffer.capacity() * sizeof(typename Vector::value_type) };
+        if (m_next == m_capacities.size()) { m_capacities.push_back(0); }
+        if (bytes > m_capacities[m_next]) { ++m_frame_growths; }
+        m_capacities[m_next++] = bytes;
+        m_bytes += bytes;
+    }
+
+    // ends the frame whose buffers were just added
+    void finish()
+    {
+        m_capacities.resize(m_next);
+        m_stats.bytes = m_bytes;
+        m_stats.high_water_bytes = std::max(m_stats.high_water_bytes, m_bytes);
+        m_stats.frame_growths = m_frame_growths;
+        m_stats.growths += m_frame_growths;
+        PROFILE_COUNT(Counter::BufferGrowths, m_frame_growths);
+        ++m_stats.frames;
+
+        m_next = 0;
+        m_bytes = 0;
+        m_frame_growths = 0;
+    }
+
+    // as of the last finish()
+    const BufferStats& stats() const { return m_stats; }
+};
@@ -0,0 +1,274 @@
+#include "ContourSet.hpp"
+#include "../MarchingSquares/MarchingSquares.hpp"
+
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+    struct ClipVertex
+    {
+        glm::vec2 position { 0.0f, 0.0f };
+        float value { 0.0f };
+    };
+
+    // Sutherland-Hodgman against value >= isolevel (keep_above) or value < isolevel, along linear edges
+    unsigned int clip(const ClipVertex* in, const unsigned int count, const float isolevel, const bool keep_above, ClipVertex* out)
+    {
+        unsigned int out_count { 0 };
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const ClipVertex& cur { in[i] };
+            const ClipVertex& next { in[(i + 1) % count] };
+            const bool cur_in { (cur.value >= isolevel) == keep_above };
+            const bool next_in { (next.value >= isolevel) == keep_above };
+
+            if (cur_in) { out[out_count++] = cur; }
+            if (cur_in != next_in)
+            {
+                const float t { (isolevel - cur.value) / (next.value - cur.value) };
+                out[out_count++] = { cur.position + t * (next.position - cur.position), isolevel };
+            }
+        }
+        return out_count;
+    }
+
+    // clips a convex polygon to lo <= value < hi and fans the result into triangles
+    void fillBand(const ClipVertex* polygon, const unsigned int count, const float lo, const float hi, std::vector<Point>& triangles)
+    {
+        ClipVertex above[8];
+        ClipVertex band[12];
+        const unsigned int above_count { clip(polygon, count, lo, true, above) };
+        const unsigned int band_count { clip(above, above_count, hi, false, band) };
+
+        for (unsigned int i = 1; i + 1 < band_count; ++i)
+        {
+            triangles.emplace_back(band[0].position.x, band[0].position.y);
+            triangles.emplace_back(band[i].position.x, band[i].position.y);
+            triangles.emplace_back(band[i + 1].position.x, band[i + 1].position.y);
+        }
+    }
+}
+
+ContourSet::ContourSet(const std::vector<float>& isolevels, const bool interp, const Grid& grid)
+    : m_isolevels {}
+    , m_interp { interp }
+    , m_lines {}
+    , m_bands {}
+    , m_row_bands {}
+    , m_buffers {}
+    , m_grid { &grid }
+    , m_grid_values { grid.data() }
+{
+    setIsolevels(isolevels);
+    march(grid);
+}
+
+void ContourSet::setIsolevels(const std::vector<float>& isolevels)
+{
+    m_isolevels = isolevels;
+    std::sort(m_isolevels.begin(), m_isolevels.end());
+}
+
+void ContourSet::march(const Grid& grid)
+{
+    marchLevels(grid);
+
+    // every level and band buffer is cleared, never freed, between marches
+    m_buffers.add(m_lines);
+    for (const std::vector<Point>& line : m_lines) { m_buffers.add(line); }
+    m_buffers.add(m_bands);
+    for (const std::vector<Point>& band : m_bands) { m_buffers.add(band); }
+    m_buffers.add(m_row_bands);
+    for (const Band& band : m_row_bands)
+    {
+        m_buffers.add(band.lines);
+        for (const std::vector<Point>& line : band.lines) { m_buffers.add(line); }
+        m_buffers.add(band.bands);
+        for (const std::vector<Point>& triangles : band.bands) { m_buffers.add(triangles); }
+    }
+    m_buffers.finish();
+}
+
+void ContourSet::marchLevels(const Grid& grid)
+{
+    const unsigned int level_count { levelCount() };
+    const unsigned int band_count { level_count > 0 ? level_count - 1 : 0 };
+    m_lines.resize(level_count);
+    m_bands.resize(m_isobands ? band_count : 0);
+    for (std::vector<Point>& line : m_lines) { line.clear(); }
+    for (std::vector<Point>& band : m_bands) { band.clear(); }
+
+    m_grid = &grid;
+    m_grid_values = grid.data();
+    if (grid.resolution() < 2 || grid.rows() < 2 || level_count == 0) { return; }
+
+#ifdef _OPENMP
+    const unsigned int threads { m_threads == 0 ? static_cast<unsigned int>(omp_get_max_threads()) : m_threads };
+#else
+    const unsigned int threads { 1 };
+#endif
+
+    if (threads <= 1)
+    {
+        marchRows(0, grid.rows() - 1, m_lines, m_bands);
+        return;
+    }
+
+    // row bands as in MarchingSquares::marchParallel, stitched per level in band order
+    const unsigned int rows { grid.rows() - 1 };
+    const unsigned int row_band_count { std::min(rows, 4 * threads) };
+    if (m_row_bands.size() < row_band_count) { m_row_bands.resize(row_band_count); }
+
+    #pragma omp parallel for schedule(dynamic) num_threads(threads)
+    for (unsigned int b = 0; b < row_band_count; ++b)
+    {
+        Band& band { m_row_bands[b] };
+        band.lines.resize(level_count);
+        band.bands.resize(m_bands.size());
+        for (std::vector<Point>& line : band.lines) { line.clear(); }
+        for (std::vector<Point>& triangles : band.bands) { triangles.clear(); }
+        marchRows(rows * b / row_band_count, rows * (b + 1) / row_band_count, band.lines, band.bands);
+    }
+
+    #pragma omp parallel for schedule(dynamic) num_threads(threads)
+    for (unsigned int k = 0; k < level_count + m_bands.size(); ++k)
+    {
+        const bool is_line { k < level_count };
+        std::vector<Point>& out { is_line ? m_lines[k] : m_bands[k - level_count] };
+        for (unsigned int b = 0; b < row_band_count; ++b)
+        {
+            const std::vector<Point>& part { is_line ? m_row_bands[b].lines[k] : m_row_bands[b].bands[k - level_count] };
+            out.insert(out.end(), part.begin(), part.end());
+        }
+    }
+}
+
+glm::vec2 ContourSet::crossing(const unsigned int active_node_idx, const unsigned int inactive_node_idx, const float isolevel) const
+{
+    // the coordinate the two nodes share lerps to itself
+    return edgeCrossing(m_grid->position(active_node_idx), m_grid->position(inactive_node_idx),
+                        m_grid_values[active_node_idx], m_grid_values[inactive_node_idx], isolevel, m_interp);
+}
+
+void ContourSet::marchRows(const unsigned int y_begin, const unsigned int y_end,
+                           std::vector<std::vector<Point>>& lines, std::vector<std::vector<Point>>& bands) const
+{
+    const unsigned int resolution { m_grid->resolution() };
+    const unsigned int stride { m_grid->stride() };
+    const float* levels_begin { m_isolevels.data() };
+    const float* levels_end { levels_begin + m_isolevels.size() };
+
+    for (unsigned int y_i = y_begin; y_i < y_end; ++y_i)
+    {
+        for (unsigned int x_i = 0; x_i < resolution - 1; ++x_i)
+        {
+            const unsigned int nw_idx { stride * y_i + x_i };
+            const unsigned int ne_idx { nw_idx + 1 };
+            const unsigned int sw_idx { nw_idx + stride };
+            const unsigned int se_idx { sw_idx + 1 };
+
+            const float nw { m_grid_values[nw_idx] };
+            const float ne { m_grid_values[ne_idx] };
+            const float se { m_grid_values[se_idx] };
+            const float sw { m_grid_values[sw_idx] };
+            const float lo { std::min(std::min(nw, ne), std::min(se, sw)) };
+            const float hi { std::max(std::max(nw, ne), std::max(se, sw)) };
+
+            // levels crossing the cell: lo < level <= hi
+            const float* first { std::upper_bound(levels_begin, levels_end, lo) };
+            const float* last { std::upper_bound(first, levels_end, hi) };
+
+            for (const float* level = first; level < last; ++level)
+            {
+                const float isolevel { *level };
+                const State state { nw >= isolevel, ne >= isolevel, se >= isolevel, sw >= isolevel };
+                const EdgeCase& edge_case { edge_cases[state.state()] };
+                std::vector<Point>& out { lines[static_cast<std::size_t>(level - levels_begin)] };
+
+                for (unsigned int e = 0; e < edge_case.count; ++e)
+                {
+                    glm::vec2 p;
+                    switch (edge_case.edges[e])
+                    {
+                        case Top:    p = state.v0 ? crossing(nw_idx, ne_idx, isolevel) : crossing(ne_idx, nw_idx, isolevel); break;
+                        case Bottom: p = state.v2 ? crossing(se_idx, sw_idx, isolevel) : crossing(sw_idx, se_idx, isolevel); break;
+                        case Right:  p = state.v1 ? crossing(ne_idx, se_idx, isolevel) : crossing(se_idx, ne_idx, isolevel); break;
+                        case Left:   p = state.v0 ? crossing(nw_idx, sw_idx, isolevel) : crossing(sw_idx, nw_idx, isolevel); break;
+                    }
+                    out.emplace_back(p.x, p.y);
+                }
+            }
+
+            if (!bands.empty())
+            {
+                // Without a saddle every level cuts the cell boundary into one arc
+                // above and one below, the chords of different levels are nested and
+                // clipping the quad partitions it exactly (the clipped vertices lie on
+                // the boundary in order, so each polygon is convex). If any level falls
+                // between the two diagonals, clipping the quad would join both diagonal
+                // corners through the middle in neighbouring bands, so the whole cell
+                // is split into four triangles around its centre instead.
+                const float a_lo { std::min(nw, se) };
+                const float a_hi { std::max(nw, se) };
+                const float b_lo { std::min(ne, sw) };
+                const float b_hi { std::max(ne, sw) };
+                const float saddle_lo { a_lo > b_hi ? b_hi : a_hi };
+                const float saddle_hi { a_lo > b_hi ? a_lo : b_lo };
+                const bool saddle { saddle_lo < saddle_hi && std::upper_bound(first, last, saddle_lo) < std::upper_bound(first, last, saddle_hi) };
+
+                // bands [isolevels[k], isolevels[k + 1]) overlapping [lo, hi]
+                const std::size_t k_begin { static_cast<std::size_t>(std::max<std::ptrdiff_t>(first - levels_begin - 1, 0)) };
+                const std::size_t k_end { std::min(static_cast<std::size_t>(last - levels_begin), bands.size()) };
+                for (std::size_t k = k_begin; k < k_end; ++k)
+                {
+                    addBand(nw_idx, sw_idx, m_isolevels[k], m_isolevels[k + 1], saddle, bands[k]);
+                }
+            }
+        }
+    }
+}
+
+void ContourSet::addBand(const unsigned int nw_idx, const unsigned int sw_idx, const float lo, const float hi, const bool saddle, std::vector<Point>& triangles) const
+{
+    // corners in boundary order
+    const ClipVertex quad[4] {
+        { m_grid->position(nw_idx), m_grid_values[nw_idx] },
+        { m_grid->position(nw_idx + 1), m_grid_values[nw_idx + 1] },
+        { m_grid->position(sw_idx + 1), m_grid_values[sw_idx + 1] },
+        { m_grid->position(sw_idx), m_grid_values[sw_idx] }
+    };
+
+    if (!saddle)
+    {
+        fillBand(quad, 4, lo, hi, triangles);
+        return;
+    }
+
+    const ClipVertex center {
+        (quad[0].position + quad[2].position) / 2.0f,
+        (quad[0].value + quad[1].value + quad[2].value + quad[3].value) / 4.0f
+    };
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        const ClipVertex triangle[3] { quad[i], quad[(i + 1) % 4], center };
+        fillBand(triangle, 3, lo, hi, triangles);
+    }
+}
+
+std::vector<float> ContourSet::positions(const unsigned int level) const
+{
+    std::vector<float> positions;
+    positions.reserve(2 * m_lines[level].size());
+
+    for (const Point& point : m_lines[level])
+    {
+        positions.push_back(point.position().x);
+        positions.push_back(point.position().y);
+    }
+
+    return positions;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include "../Point/Point.hpp"
+#include "../Grid/Grid.hpp"
+#include "../BufferStats/BufferStats.hpp"
+
+// Isolines for many isolevels (and optionally the filled isobands between
+// consecutive levels) in a single traversal of the grid. Each cell looks up
+// the range of levels between its corner min and max, so levels that do not
+// cross it cost nothing.
+class ContourSet
+{
+private:
+    std::vector<float> m_isolevels; // ascending
+    bool m_interp;
+    bool m_isobands { false };
+    unsigned int m_threads { 1 };
+
+    // m_lines[k]: segment endpoint pairs of level k, in the same order MarchingSquares emits them
+    std::vector<std::vector<Point>> m_lines;
+    // m_bands[k]: triangles covering isolevels[k] <= value < isolevels[k + 1]
+    std::vector<std::vector<Point>> m_bands;
+
+    struct Band
+    {
+        std::vector<std::vector<Point>> lines {};
+        std::vector<std::vector<Point>> bands {};
+    };
+    std::vector<Band> m_row_bands;
+
+    BufferTracker m_buffers;
+
+    // the grid of the last march
+    const Grid* m_grid;
+    const float* m_grid_values;
+
+    glm::vec2 crossing(const unsigned int active_node_idx, const unsigned int inactive_node_idx, const float isolevel) const;
+    void marchRows(const unsigned int y_begin, const unsigned int y_end,
+                   std::vector<std::vector<Point>>& lines, std::vector<std::vector<Point>>& bands) const;
+    void marchLevels(const Grid& grid);
+    void addBand(const unsigned int nw_idx, const unsigned int sw_idx, const float lo, const float hi, const bool saddle, std::vector<Point>& triangles) const;
+
+public:
+    ContourSet(const std::vector<float>& isolevels, const bool interp, const Grid& grid);
+
+    void march(const Grid& grid);
+
+    unsigned int levelCount() const { return static_cast<unsigned int>(m_isolevels.size()); }
+    const std::vector<float>& isolevels() const { return m_isolevels; }
+    // sorted ascending; level indices refer to this order
+    void setIsolevels(const std::vector<float>& isolevels);
+
+    const std::vector<Point>& isoline(const unsigned int level) const { return m_lines[level]; }
+    std::vector<float> positions(const unsigned int level) const;
+
+    // filled regions between consecutive levels, as triangle lists (levelCount() - 1 bands);
+    // band edges are always interpolated, midpoints cannot split a cell between several levels
+    bool isobands() const { return m_isobands; }
+    void setIsobands(const bool isobands) { m_isobands = isobands; }
+    const std::vector<Point>& isoband(const unsigned int band) const { return m_bands[band]; }
+
+    // capacity held by the isolines, isobands and row band buffers after the last march, and how often they grew
+    const BufferStats& bufferStats() const { return m_buffers.stats(); }
+
+    unsigned int threads() const { return m_threads; }
+    void setThreads(const unsigned int threads) { m_threads = threads; }
+};
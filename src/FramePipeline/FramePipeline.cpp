@@ -0,0 +1,104 @@
+#include "FramePipeline.hpp"
+#include <algorithm>
+#include <utility>
+#include "../Profiler/Profiler.hpp"
+
+FramePipeline::Frame::Frame(Grid&& frame_grid, const float frame_isolevel, const bool interp)
+    : grid { std::move(frame_grid) }
+    , marcher { frame_isolevel, interp, grid }
+    , positions {}
+    , isolevel { frame_isolevel }
+{
+}
+
+FramePipeline::FramePipeline(const std::function<Grid()>& make_grid, const float isolevel, const bool interp, Fill fill, const unsigned int depth)
+    : m_frames {}
+    , m_fill { std::move(fill) }
+    , m_mutex {}
+    , m_changed {}
+    , m_worker {}
+{
+    for (unsigned int i = 0; i < std::max(depth, 1u); ++i)
+    {
+        m_frames.push_back(std::make_unique<Frame>(make_grid(), isolevel, interp));
+    }
+    m_worker = std::thread(&FramePipeline::run, this);
+}
+
+FramePipeline::~FramePipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock { m_mutex };
+        m_stop = true;
+    }
+    m_changed.notify_all();
+    m_worker.join();
+}
+
+void FramePipeline::submit(const float time, const float isolevel)
+{
+    std::unique_lock<std::mutex> lock { m_mutex };
+    m_changed.wait(lock, [this] { return m_submitted - m_released < m_frames.size(); });
+
+    Frame& frame { *m_frames[m_submitted % m_frames.size()] };
+    frame.index = m_submitted;
+    frame.time = time;
+    frame.isolevel = isolevel;
+    ++m_submitted;
+
+    lock.unlock();
+    m_changed.notify_all();
+}
+
+const FramePipeline::Frame* FramePipeline::acquire()
+{
+    PROFILE_ZONE("FramePipeline::acquire");
+    std::unique_lock<std::mutex> lock { m_mutex };
+    if (m_acquired == m_submitted) { return nullptr; }
+    m_changed.wait(lock, [this] { return m_produced > m_acquired; });
+
+    return m_frames[m_acquired++ % m_frames.size()].get();
+}
+
+void FramePipeline::release()
+{
+    {
+        std::lock_guard<std::mutex> lock { m_mutex };
+        if (m_released == m_acquired) { return; }
+        ++m_released;
+    }
+    m_changed.notify_all();
+}
+
+unsigned int FramePipeline::inFlight() const
+{
+    std::lock_guard<std::mutex> lock { m_mutex };
+    return static_cast<unsigned int>(m_submitted - m_released);
+}
+
+void FramePipeline::run()
+{
+    PROFILE_THREAD("FramePipeline");
+    std::unique_lock<std::mutex> lock { m_mutex };
+    while (true)
+    {
+        m_changed.wait(lock, [this] { return m_stop || m_produced < m_submitted; });
+        if (m_produced == m_submitted) { return; }
+
+        // the slot is ours until m_produced moves past it; submit() never hands it out again before release()
+        Frame& frame { *m_frames[m_produced % m_frames.size()] };
+        lock.unlock();
+
+        {
+            PROFILE_ZONE("FramePipeline::frame");
+            m_fill(frame);
+            frame.marcher.setIsolevel(frame.isolevel);
+            frame.marcher.march(frame.grid);
+            frame.marcher.positions(frame.positions);
+        }
+
+        lock.lock();
+        ++m_produced;
+        m_changed.notify_all();
+    }
+}
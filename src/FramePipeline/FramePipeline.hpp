@@ -0,0 +1,78 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../Grid/Grid.hpp"
+#include "../MarchingSquares/MarchingSquares.hpp"
+
+// Overlaps the field evaluation and march of the next frame with the consumer
+// (upload and draw) of the current one. Frames cycle through `depth` slots, each
+// owning a Grid and the MarchingSquares bound to it: submit() queues a slot for
+// the worker thread, which fills, marches and flattens it; acquire() returns the
+// oldest submitted frame once it is done and release() hands its slot back.
+// submit() blocks while every slot is in use, so the worker never runs more than
+// depth - 1 frames ahead of the one being consumed (2: double buffering, one
+// frame of latency), and a frame's buffers are never written while the consumer
+// holds them.
+class FramePipeline
+{
+public:
+    struct Frame
+    {
+        Grid grid;
+        MarchingSquares marcher;
+        // marcher.positions(), flattened on the worker so the consumer only uploads;
+        // reused frame to frame, so it stops allocating once it has seen the longest contour
+        std::vector<float> positions;
+        std::uint64_t index { 0 };
+        float time { 0.0f };
+        float isolevel { 0.0f };
+
+        Frame(Grid&& frame_grid, const float frame_isolevel, const bool interp);
+        Frame(const Frame&) = delete;
+        Frame& operator=(const Frame&) = delete;
+    };
+
+    // fills frame.grid for frame.time on the worker thread, one frame at a time in
+    // submission order; it may also configure frame.marcher, which is then marched at frame.isolevel
+    using Fill = std::function<void(Frame& frame)>;
+
+    FramePipeline(const std::function<Grid()>& make_grid, const float isolevel, const bool interp, Fill fill, const unsigned int depth = 2);
+    // finishes the frames already submitted and joins the worker
+    ~FramePipeline();
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    void submit(const float time, const float isolevel);
+    // blocks until the oldest unconsumed frame is done; nullptr if none was submitted
+    const Frame* acquire();
+    // hands the oldest acquired frame's slot back
+    void release();
+
+    unsigned int depth() const { return static_cast<unsigned int>(m_frames.size()); }
+    // frames submitted and not yet released
+    unsigned int inFlight() const;
+
+private:
+    std::vector<std::unique_ptr<Frame>> m_frames;
+    Fill m_fill;
+
+    // frame n lives in slot n % depth; released <= acquired <= produced <= submitted <= released + depth
+    std::uint64_t m_submitted { 0 };
+    std::uint64_t m_produced { 0 };
+    std::uint64_t m_acquired { 0 };
+    std::uint64_t m_released { 0 };
+    bool m_stop { false };
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::thread m_worker;
+
+    void run();
+};
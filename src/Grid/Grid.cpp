@@ -1,110 +1,624 @@
 #include "Grid.hpp"
+#include "../Profiler/Profiler.hpp"
 
-Grid::Grid(const float width, const float height, const unsigned int resolution, float (*f)(const glm::vec2&))
-    : m_resolution { resolution }
-{
-    m_points.reserve(resolution * resolution);
-    m_values.reserve(resolution * resolution);
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <type_traits>
+#include <utility>
 
-    createPoints(width, height);
-    for (const Point& point : m_points)
+namespace
+{
+// adds one particle's contribution to nodes [x_begin, x_end] of a row, dy from the particle;
+// branch free so it vectorizes, nodes that round to just outside the disc add 0
+template <typename Sum>
+void addDisc(Sum* sum, const int x_begin, const int x_end, const float origin_x, const float step_x, const float center_x,
+             const float dy, const float radius, const float cutoff2, const float inv_cutoff2, const bool compact)
+{
+    for (int x_i = x_begin; x_i <= x_end; ++x_i)
     {
-        m_values.emplace_back(f(point.position()));
+        const float dx { origin_x + static_cast<float>(static_cast<unsigned int>(x_i)) * step_x - center_x };
+        const float d2 { dx * dx + dy * dy };
+        const float s { 1.0f - d2 * inv_cutoff2 };
+        const float value { radius / std::sqrt(d2) * (compact ? s * s : 1.0f) };
+        sum[x_i] += d2 < cutoff2 ? value : 0.0f;
     }
 }
 
-Grid::Grid(const float width, const float height, const unsigned int resolution, float (*f)(const glm::vec2&, const float))
+// s clamped to [lo, hi] in float, as the conversion is undefined outside int's range; NaN gives lo
+int clampToInt(const float s, const int lo, const int hi)
+{
+    if (!(s > static_cast<float>(lo))) { return lo; }
+    return s < static_cast<float>(hi) ? static_cast<int>(s) : hi;
+}
+
+bool validCutoff(const float cutoff)
+{
+    if (cutoff > 0.0f && std::isfinite(cutoff)) { return true; }
+    std::cerr << "Grid: cutoff " << cutoff << " is not positive and finite, summing every particle\n";
+    return false;
+}
+}
+
+template <typename T>
+BasicGrid<T>::BasicGrid(const float width, const float height, const unsigned int resolution, float (*f)(const glm::vec2&))
     : m_resolution { resolution }
+    , m_rows { resolution }
+    , m_stride { resolution }
+    , m_values(resolution * resolution, T {})
 {
-    m_points.reserve(resolution * resolution);
-    m_values.reserve(resolution * resolution);
+    computeSpacing(width, height);
+    assignValues(f);
+}
 
-    createPoints(width, height);
-    for (const Point& point : m_points)
-    {
-        m_values.emplace_back(f(point.position(), 0.0f));
-    }
+template <typename T>
+BasicGrid<T>::BasicGrid(const float width, const float height, const unsigned int resolution, float (*f)(const glm::vec2&, const float))
+    : m_resolution { resolution }
+    , m_rows { resolution }
+    , m_stride { resolution }
+    , m_values(resolution * resolution, T {})
+{
+    computeSpacing(width, height);
+    assignValues(f, 0.0f);
 }
 
-Grid::Grid(const float width, const float height, const unsigned int resolution, const bool walls, std::vector<Particle>& particles)
+template <typename T>
+BasicGrid<T>::BasicGrid(const float width, const float height, const unsigned int resolution, const bool walls, const std::vector<Particle>& particles)
     : m_resolution { resolution }
-    , m_values(resolution * resolution, 0.0f)
+    , m_rows { resolution }
+    , m_stride { resolution }
+    , m_values(resolution * resolution, T {})
     , m_walls { walls }
 {
-    m_points.reserve(resolution * resolution);
+    computeSpacing(width, height);
+    assignValues(particles);
+}
 
-    createPoints(width, height);
+template <typename T>
+BasicGrid<T>::BasicGrid(const float width, const float height, const unsigned int resolution, const bool walls, const Particles& particles)
+    : m_resolution { resolution }
+    , m_rows { resolution }
+    , m_stride { resolution }
+    , m_values(resolution * resolution, T {})
+    , m_walls { walls }
+{
+    computeSpacing(width, height);
     assignValues(particles);
 }
 
-Grid::Grid(const float width, const float height, const unsigned int resolution, const PerlinNoise& perlin)
+template <typename T>
+BasicGrid<T>::BasicGrid(const float width, const float height, const unsigned int resolution, const PerlinNoise& perlin)
 : m_resolution { resolution }
+, m_rows { resolution }
+, m_stride { resolution }
+, m_values(resolution * resolution, T {})
 {
-    m_points.reserve(resolution * resolution);
-    m_values.reserve(resolution * resolution);
+    computeSpacing(width, height);
+    assignValues(perlin, 0.0f);
+}
+
+template <typename T>
+BasicGrid<T>::BasicGrid(BasicMappedRaster<T>&& raster, const glm::vec2& origin, const float dx, const float dy)
+    : m_resolution { raster.width() }
+    , m_rows { raster.height() }
+    , m_stride { raster.stride() }
+    , m_origin { origin }
+    , m_dx { dx }
+    , m_dy { dy }
+    , m_values {}
+    , m_raster { std::move(raster) }
+{
+    // nothing is read here: the tile ranges are computed on the first march
+    computeTiles();
+    markAllDirty();
+}
 
-    createPoints(width, height);
-    for (const Point& point : m_points)
+template <typename T>
+BasicGrid<T>::BasicGrid(const unsigned int resolution, const unsigned int rows, const glm::vec2& origin, const float dx, const float dy)
+    : m_resolution { resolution }
+    , m_rows { rows }
+    , m_stride { resolution }
+    , m_origin { origin }
+    , m_dx { dx }
+    , m_dy { dy }
+    , m_values(static_cast<std::size_t>(resolution) * rows, T {})
+    , m_raster {}
+{
+    computeTiles();
+    markAllDirty();
+}
+
+template <typename T>
+void BasicGrid<T>::assignValues(float (*f)(const glm::vec2&))
+{
+    PROFILE_ZONE("Grid::assignValues");
+    markAllDirty();
+
+    for (unsigned int y_i = 0; y_i < m_rows; ++y_i)
     {
-        m_values.emplace_back(perlin.noise(point.position(), 0.0f));
+        T* row { data() + static_cast<std::size_t>(y_i) * m_stride };
+        for (unsigned int x_i = 0; x_i < m_resolution; ++x_i)
+        {
+            row[x_i] = ScalarTraits<T>::store(f(glm::vec2(x(x_i), y(y_i))));
+        }
     }
 }
 
-void Grid::assignValues(float (*f)(const glm::vec2&))
+template <typename T>
+void BasicGrid<T>::assignValues(float (*f)(const glm::vec2&, const float t), const float t)
 {
-    for (unsigned int i = 0; i < m_values.size(); ++i)
+    PROFILE_ZONE("Grid::assignValues");
+    markAllDirty();
+
+    for (unsigned int y_i = 0; y_i < m_rows; ++y_i)
     {
-        m_values[i] = f(m_points[i].position());
+        T* row { data() + static_cast<std::size_t>(y_i) * m_stride };
+        for (unsigned int x_i = 0; x_i < m_resolution; ++x_i)
+        {
+            row[x_i] = ScalarTraits<T>::store(f(glm::vec2(x(x_i), y(y_i)), t));
+        }
     }
 }
 
-void Grid::assignValues(float (*f)(const glm::vec2&, const float t), const float t)
+template <typename T>
+void BasicGrid<T>::assignValues(const std::vector<Particle>& particles)
 {
-    for (unsigned int i = 0; i < m_values.size(); ++i)
+    PROFILE_ZONE("Grid::assignValues");
+    m_particle_positions.resize(particles.size());
+    m_particle_radii.resize(particles.size());
+    for (std::size_t i = 0; i < particles.size(); ++i)
     {
-        m_values[i] = f(m_points[i].position(), t);
+        m_particle_positions[i] = particles[i].position();
+        m_particle_radii[i] = particles[i].radius();
     }
+    sumParticles(m_particle_positions.data(), m_particle_radii.data(), particles.size());
 }
 
-void Grid::assignValues(std::vector<Particle>& particles)
+template <typename T>
+void BasicGrid<T>::assignValues(const Particles& particles)
 {
-    for (unsigned int i = 0; i < m_points.size(); ++i)
+    PROFILE_ZONE("Grid::assignValues");
+    sumParticles(particles.positions().data(), particles.radii().data(), particles.size());
+}
+
+template <typename T>
+void BasicGrid<T>::sumParticles(const glm::vec2* positions, const float* radii, const std::size_t count)
+{
+    markAllDirty();
+
+    // every node sums the particles in the same order, so rows can be filled in parallel
+    T* values { data() };
+    #pragma omp parallel for schedule(static)
+    for (unsigned int y_i = 0; y_i < m_rows; ++y_i)
     {
-        if ( m_walls ? ( (i > m_resolution) && (i % m_resolution > 0) && (i % m_resolution < m_resolution - 1) && (i < m_resolution * (m_resolution - 1)) ) : true)
+        for (unsigned int x_i = 0; x_i < m_resolution; ++x_i)
         {
-            const glm::vec2& location = m_points[i].position();
-            float& value = m_values[i];
-            value = 0.0f;
-            for (Particle& particle : particles)
+            // with walls the boundary nodes are left as they are
+            if ( m_walls ? ( (y_i > 0) && (x_i > 0) && (x_i < m_resolution - 1) && (y_i < m_rows - 1) ) : true)
             {
-                // possible parallelization: use different thread for each particle
-                value += particle.radius() / glm::length(location - particle.position());
+                const glm::vec2 location { x(x_i), y(y_i) };
+                float value { 0.0f };
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    value += radii[i] / glm::length(location - positions[i]);
+                }
+                values[y_i * m_stride + x_i] = ScalarTraits<T>::store(value);
             }
         }
     }
 }
 
-void Grid::assignValues(const PerlinNoise& perlin, const float t)
+template <typename T>
+void BasicGrid<T>::assignValues(const std::vector<Particle>& particles, const float cutoff, const Falloff falloff)
 {
-    for (unsigned int i = 0; i < m_values.size(); ++i)
+    if (!validCutoff(cutoff))
+    {
+        assignValues(particles);
+        return;
+    }
+    PROFILE_ZONE("Grid::assignValues");
+    const std::uint64_t since { m_version };
+    const bool mark { beginParticles(particles.size(), cutoff, falloff) };
+    for (std::size_t i = 0; i < particles.size(); ++i)
     {
-        m_values[i] = perlin.noise(m_points[i].position(), t);
+        recordParticle(i, particles[i].position(), particles[i].radius(), mark);
     }
+    sumParticlesWithin(cutoff, falloff, since);
+    m_cutoff_filled = true;
+    m_cutoff_fill = { cutoff, falloff, m_walls };
 }
 
-void Grid::createPoints(const float width, const float height)
+template <typename T>
+void BasicGrid<T>::assignValues(const Particles& particles, const float cutoff, const Falloff falloff)
+{
+    if (!validCutoff(cutoff))
+    {
+        assignValues(particles);
+        return;
+    }
+    PROFILE_ZONE("Grid::assignValues");
+    const std::uint64_t since { m_version };
+    const bool mark { beginParticles(particles.size(), cutoff, falloff) };
+    const glm::vec2* positions { particles.positions().data() };
+    const float* radii { particles.radii().data() };
+    for (std::size_t i = 0; i < particles.size(); ++i)
+    {
+        recordParticle(i, positions[i], radii[i], mark);
+    }
+    sumParticlesWithin(cutoff, falloff, since, particles.hash());
+    m_cutoff_filled = true;
+    m_cutoff_fill = { cutoff, falloff, m_walls };
+}
+
+template <typename T>
+bool BasicGrid<T>::beginParticles(const std::size_t count, const float cutoff, const Falloff falloff)
+{
+    // only the nodes within the cutoff of a moved (or resized) particle's old and new position can
+    // change; with more particles than tiles nearly every tile has one, so mark them all up front
+    const bool same_setup {
+        m_cutoff_filled && m_cutoff_fill.cutoff == cutoff && m_cutoff_fill.falloff == falloff && m_cutoff_fill.walls == m_walls &&
+        m_particle_hash.cellSize() == cutoff && m_particle_radii.size() == count
+    };
+    const bool mark { same_setup && count <= m_tile_versions.size() };
+    if (!mark) { markAllDirty(); }
+
+    m_particle_positions.resize(count);
+    m_particle_radii.resize(count);
+    return mark;
+}
+
+template <typename T>
+void BasicGrid<T>::recordParticle(const std::size_t i, const glm::vec2& position, const float radius, const bool mark)
+{
+    if (mark && (position.x != m_particle_positions[i].x || position.y != m_particle_positions[i].y || radius != m_particle_radii[i]))
+    {
+        const glm::vec2 reach { m_particle_hash.cellSize(), m_particle_hash.cellSize() };
+        markDirtyArea(m_particle_positions[i] - reach, m_particle_positions[i] + reach);
+        markDirtyArea(position - reach, position + reach);
+    }
+    m_particle_positions[i] = position;
+    m_particle_radii[i] = radius;
+}
+
+template <typename T>
+void BasicGrid<T>::sumParticlesWithin(const float cutoff, const Falloff falloff, const std::uint64_t since, const SpatialHash* bins)
+{
+    // bins as large as the cutoff, so a node only sees the bin rows within one cutoff of it;
+    // other bins work too, rows just see fewer or more candidates
+    if (m_particle_hash.cellSize() != cutoff)
+    {
+        const glm::vec2 size { m_dx * static_cast<float>(m_resolution - 1), m_dy * static_cast<float>(m_rows - 1) };
+        m_particle_hash = SpatialHash(m_origin, size, cutoff);
+    }
+    if (!bins)
+    {
+        m_particle_hash.build(m_particle_positions.data(), static_cast<unsigned int>(m_particle_positions.size()), 0);
+        bins = &m_particle_hash;
+    }
+    const SpatialHash& hash { *bins };
+
+    // with walls the boundary nodes are left at 0
+    const int lo { m_walls ? 1 : 0 };
+    const int hi { static_cast<int>(m_resolution) - (m_walls ? 2 : 1) };
+    const int hi_y { static_cast<int>(m_rows) - (m_walls ? 2 : 1) };
+    const float cutoff2 { cutoff * cutoff };
+    const float inv_cutoff2 { 1.0f / cutoff2 };
+    const bool compact { falloff == Falloff::Compact };
+    // x(x_i) from locals
+    const float origin_x { m_origin.x };
+    const float step_x { m_dx };
+
+    // only the nodes of tiles marked dirty since `since` are rewritten: all of them after
+    // markAllDirty(), the ones around the moved particles otherwise (see recordParticle);
+    // the others keep the previous fill's values, which the same particles summed in the same order
+    const unsigned int cells_x { m_resolution > 1 ? m_resolution - 1 : 0 };
+    const unsigned int cells_y { m_rows > 1 ? m_rows - 1 : 0 };
+    const bool tiled { m_tiles_x > 0 && m_tiles_y > 0 };
+
+    // each row gathers the particles whose cutoff disc crosses it and only
+    // visits the nodes inside that disc, so rows can be filled in parallel;
+    // types narrower than float (Half, uint16) sum in a float row first
+    constexpr bool sum_in_place { std::is_same_v<T, compute_type> };
+    #pragma omp parallel
+    {
+        std::vector<compute_type> sums(sum_in_place ? 0 : m_resolution);
+        // nodes [begin, end] of the row to rewrite
+        std::vector<std::array<int, 2>> runs;
+
+        #pragma omp for schedule(dynamic, 16)
+        for (unsigned int y_i = 0; y_i < m_rows; ++y_i)
+        {
+            // a node is a corner of the tiles of the cells around it
+            runs.clear();
+            if (!tiled) { runs.push_back({ 0, static_cast<int>(m_resolution) - 1 }); }
+            else
+            {
+                const std::uint64_t* below { &m_tile_versions[std::min(y_i, cells_y - 1) / tile_size * m_tiles_x] };
+                const std::uint64_t* above { &m_tile_versions[(y_i > 0 ? std::min(y_i - 1, cells_y - 1) : 0) / tile_size * m_tiles_x] };
+                for (unsigned int tx = 0; tx < m_tiles_x; ++tx)
+                {
+                    if (below[tx] <= since && above[tx] <= since) { continue; }
+                    const int begin { static_cast<int>(tx * tile_size) };
+                    const int end { static_cast<int>(std::min((tx + 1) * tile_size, cells_x)) };
+                    if (!runs.empty() && runs.back()[1] >= begin) { runs.back()[1] = end; }
+                    else { runs.push_back({ begin, end }); }
+                }
+            }
+            if (runs.empty()) { continue; }
+
+            T* row { data() + static_cast<std::size_t>(y_i) * m_stride };
+            for (const std::array<int, 2>& run : runs) { std::fill(row + run[0], row + run[1] + 1, T {}); }
+            if (static_cast<int>(y_i) < lo || static_cast<int>(y_i) > hi_y) { continue; }
+
+            compute_type* sum;
+            if constexpr (sum_in_place) { sum = row; }
+            else
+            {
+                sum = sums.data();
+                for (const std::array<int, 2>& run : runs) { std::fill(sums.begin() + run[0], sums.begin() + run[1] + 1, compute_type {}); }
+            }
+
+            const float y { this->y(y_i) };
+            const unsigned int cy_end { hash.cellY(y + cutoff) };
+            for (unsigned int cy = hash.cellY(y - cutoff); cy <= cy_end; ++cy)
+            {
+                const unsigned int* last { hash.end(hash.nx() - 1, cy) };
+                for (const unsigned int* it = hash.begin(0, cy); it != last; ++it)
+                {
+                    const glm::vec2& center { m_particle_positions[*it] };
+                    const float radius { m_particle_radii[*it] };
+                    const float dy { y - center.y };
+                    const float half2 { cutoff2 - dy * dy };
+                    if (half2 <= 0.0f) { continue; }
+
+                    // nodes of this row inside the cutoff disc
+                    const float half { std::sqrt(half2) };
+                    const int x_begin { clampToInt(std::ceil((center.x - half - m_origin.x) / m_dx), lo, hi + 1) };
+                    const int x_end { clampToInt(std::floor((center.x + half - m_origin.x) / m_dx), lo - 1, hi) };
+
+                    for (const std::array<int, 2>& run : runs)
+                    {
+                        addDisc(sum, std::max(x_begin, run[0]), std::min(x_end, run[1]), origin_x, step_x, center.x, dy, radius, cutoff2, inv_cutoff2, compact);
+                    }
+                }
+            }
+
+            if constexpr (!sum_in_place)
+            {
+                for (const std::array<int, 2>& run : runs)
+                {
+                    for (int x_i = run[0]; x_i <= run[1]; ++x_i) { row[x_i] = ScalarTraits<T>::store(sums[static_cast<std::size_t>(x_i)]); }
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+void BasicGrid<T>::assignValues(const PerlinNoise& perlin, const float t)
+{
+    PROFILE_ZONE("Grid::assignValues");
+    markAllDirty();
+
+    // whole rows at a time through the batch (SIMD) noise kernels
+    if constexpr (std::is_same_v<T, float>)
+    {
+        perlin.noiseGrid(m_origin, m_dx, m_dy, m_resolution, m_rows, t, data(), m_stride);
+    }
+    else
+    {
+        #pragma omp parallel
+        {
+            std::vector<float> noise(m_resolution);
+
+            #pragma omp for schedule(static)
+            for (unsigned int y_i = 0; y_i < m_rows; ++y_i)
+            {
+                perlin.noiseRow(m_origin.x, m_dx, m_resolution, y(y_i), t, noise.data());
+                T* row { data() + static_cast<std::size_t>(y_i) * m_stride };
+                for (unsigned int x_i = 0; x_i < m_resolution; ++x_i) { row[x_i] = ScalarTraits<T>::store(noise[x_i]); }
+            }
+        }
+    }
+}
+
+template <typename T>
+void BasicGrid<T>::computeSpacing(const float width, const float height)
 {
     // Determine the aspect ratio
     const float aspectRatio = width / height;
 
-    float dx { width / (m_resolution - 1) };
-    float dy { height / (static_cast<unsigned int>(m_resolution / aspectRatio) - 1) };
+    m_dx = width / static_cast<float>(m_resolution - 1);
+    m_dy = height / static_cast<float>(static_cast<unsigned int>(static_cast<float>(m_resolution) / aspectRatio) - 1);
 
-    for (unsigned int y_i = 0; y_i < m_resolution; ++y_i)
+    computeTiles();
+}
+
+template <typename T>
+void BasicGrid<T>::computeTiles()
+{
+    const unsigned int cells_x { m_resolution > 1 ? m_resolution - 1 : 0 };
+    const unsigned int cells_y { m_rows > 1 ? m_rows - 1 : 0 };
+    m_tiles_x = (cells_x + tile_size - 1) / tile_size;
+    m_tiles_y = (cells_y + tile_size - 1) / tile_size;
+    m_tile_versions.assign(m_tiles_x * m_tiles_y, 0);
+
+    m_range_levels.clear();
+    m_level_widths.clear();
+    m_level_heights.clear();
+    if (m_tiles_x == 0 || m_tiles_y == 0) { return; }
+    for (unsigned int width = m_tiles_x, height = m_tiles_y; ; width = (width + 1) / 2, height = (height + 1) / 2)
     {
-        for (unsigned int x_i = 0; x_i < m_resolution; ++x_i)
+        m_range_levels.emplace_back(width * height, ValueRange { 0.0f, 0.0f });
+        m_level_widths.push_back(width);
+        m_level_heights.push_back(height);
+        if (width == 1 && height == 1) { break; }
+    }
+}
+
+template <typename T>
+void BasicGrid<T>::setValue(T val, unsigned int idx)
+{
+    data()[idx] = val;
+    markDirty(idx % m_stride, idx / m_stride, idx % m_stride + 1, idx / m_stride + 1);
+}
+
+template <typename T>
+void BasicGrid<T>::markDirty(const unsigned int x_begin, const unsigned int y_begin, const unsigned int x_end, const unsigned int y_end)
+{
+    // a node is a corner of the cells to its left/right and above/below it
+    const unsigned int cx_begin { x_begin > 0 ? x_begin - 1 : 0 };
+    const unsigned int cy_begin { y_begin > 0 ? y_begin - 1 : 0 };
+    const unsigned int cx_end { std::min(x_end, m_resolution > 1 ? m_resolution - 1 : 0) };
+    const unsigned int cy_end { std::min(y_end, m_rows > 1 ? m_rows - 1 : 0) };
+    m_cutoff_filled = false;
+    if (cx_begin >= cx_end || cy_begin >= cy_end) { return; }
+
+    ++m_version;
+    for (unsigned int ty = cy_begin / tile_size; ty <= (cy_end - 1) / tile_size; ++ty)
+    {
+        for (unsigned int tx = cx_begin / tile_size; tx <= (cx_end - 1) / tile_size; ++tx)
+        {
+            m_tile_versions[ty * m_tiles_x + tx] = m_version;
+        }
+    }
+}
+
+template <typename T>
+void BasicGrid<T>::markAllDirty()
+{
+    m_cutoff_filled = false;
+    ++m_version;
+    std::fill(m_tile_versions.begin(), m_tile_versions.end(), m_version);
+}
+
+template <typename T>
+void BasicGrid<T>::markDirtyArea(const glm::vec2& min, const glm::vec2& max)
+{
+    // nodes inside the world space box [min, max]
+    const auto first = [](const float s, const unsigned int limit) { return static_cast<unsigned int>(std::clamp(std::ceil(s), 0.0f, static_cast<float>(limit))); };
+    const auto last = [](const float s, const unsigned int limit) { return static_cast<unsigned int>(std::clamp(std::floor(s) + 1.0f, 0.0f, static_cast<float>(limit))); };
+    markDirty(
+        first((min.x - m_origin.x) / m_dx, m_resolution), first((min.y - m_origin.y) / m_dy, m_rows),
+        last((max.x - m_origin.x) / m_dx, m_resolution), last((max.y - m_origin.y) / m_dy, m_rows)
+    );
+}
+
+template <typename T>
+void BasicGrid<T>::updateRanges() const
+{
+    if (m_ranges_version == m_version || m_range_levels.empty()) { return; }
+
+    // rescan the tiles changed since the last update
+    const unsigned int cells_x { m_resolution - 1 };
+    const unsigned int cells_y { m_rows - 1 };
+    const T* values { data() };
+    std::vector<ValueRange>& tiles { m_range_levels[0] };
+    #pragma omp parallel for schedule(dynamic)
+    for (unsigned int t = 0; t < tiles.size(); ++t)
+    {
+        if (m_tile_versions[t] <= m_ranges_version) { continue; }
+
+        const unsigned int x_begin { (t % m_tiles_x) * tile_size };
+        const unsigned int y_begin { (t / m_tiles_x) * tile_size };
+        const unsigned int x_end { std::min(x_begin + tile_size, cells_x) };
+        const unsigned int y_end { std::min(y_begin + tile_size, cells_y) };
+
+        const compute_type first { ScalarTraits<T>::compute(values[static_cast<std::size_t>(y_begin) * m_stride + x_begin]) };
+        ValueRange range { first, first };
+        for (unsigned int y_i = y_begin; y_i <= y_end; ++y_i)
         {
-            m_points.emplace_back(Point(static_cast<float>(x_i) * dx, static_cast<float>(y_i) * dy));
+            const T* row { values + static_cast<std::size_t>(y_i) * m_stride };
+            for (unsigned int x_i = x_begin; x_i <= x_end; ++x_i)
+            {
+                const compute_type value { ScalarTraits<T>::compute(row[x_i]) };
+                range.min = std::min(range.min, value);
+                range.max = std::max(range.max, value);
+            }
+        }
+        tiles[t] = range;
+    }
+    m_ranges_version = m_version;
+
+    // the coarser levels are small enough to rebuild whole
+    for (std::size_t level = 1; level < m_range_levels.size(); ++level)
+    {
+        const std::vector<ValueRange>& fine { m_range_levels[level - 1] };
+        const unsigned int fine_width { m_level_widths[level - 1] };
+        const unsigned int fine_height { m_level_heights[level - 1] };
+        const unsigned int width { m_level_widths[level] };
+        for (unsigned int y_i = 0; y_i < m_level_heights[level]; ++y_i)
+        {
+            for (unsigned int x_i = 0; x_i < width; ++x_i)
+            {
+                ValueRange range { fine[2 * y_i * fine_width + 2 * x_i] };
+                for (unsigned int c = 1; c < 4; ++c)
+                {
+                    const unsigned int fx { 2 * x_i + (c & 1) };
+                    const unsigned int fy { 2 * y_i + (c >> 1) };
+                    if (fx >= fine_width || fy >= fine_height) { continue; }
+                    range.min = std::min(range.min, fine[fy * fine_width + fx].min);
+                    range.max = std::max(range.max, fine[fy * fine_width + fx].max);
+                }
+                m_range_levels[level][y_i * width + x_i] = range;
+            }
         }
     }
 }
+
+template <typename T>
+void BasicGrid<T>::activeTiles(const compute_type isolevel, std::vector<unsigned int>& tiles) const
+{
+    tiles.clear();
+    if (m_range_levels.empty()) { return; }
+    updateRanges();
+
+    // descend from the root, only into blocks whose range contains the isolevel
+    std::vector<RangeBlock>& stack { m_range_stack };
+    stack.assign(1, { static_cast<unsigned int>(m_range_levels.size() - 1), 0, 0 });
+    while (!stack.empty())
+    {
+        const RangeBlock block { stack.back() };
+        stack.pop_back();
+
+        const unsigned int width { m_level_widths[block.level] };
+        if (block.x >= width || block.y >= m_level_heights[block.level]) { continue; }
+
+        const ValueRange& range { m_range_levels[block.level][block.y * width + block.x] };
+        if (!(range.min < isolevel && range.max >= isolevel)) { continue; }
+
+        if (block.level == 0)
+        {
+            tiles.push_back(block.y * width + block.x);
+            continue;
+        }
+        for (unsigned int c = 0; c < 4; ++c)
+        {
+            stack.push_back({ block.level - 1, 2 * block.x + (c & 1), 2 * block.y + (c >> 1) });
+        }
+    }
+    std::sort(tiles.begin(), tiles.end());
+}
+
+template <typename T>
+const std::vector<Point>& BasicGrid<T>::points() const
+{
+    if (m_points.empty())
+    {
+        m_points.reserve(size());
+        for (unsigned int y_i = 0; y_i < m_rows; ++y_i)
+        {
+            for (unsigned int x_i = 0; x_i < m_resolution; ++x_i)
+            {
+                m_points.emplace_back(x(x_i), y(y_i));
+            }
+        }
+    }
+    return m_points;
+}
+
+template class BasicGrid<float>;
+template class BasicGrid<double>;
+template class BasicGrid<Half>;
+template class BasicGrid<std::uint16_t>;
@@ -1,36 +1,164 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include "../Point/Point.hpp"
 #include "../Particle/Particle.hpp"
 #include "../PerlinNoise/PerlinNoise.hpp"
+#include "../SpatialHash/SpatialHash.hpp"
+#include "../MappedRaster/MappedRaster.hpp"
+#include "../Scalar/Scalar.hpp"
 
-class Grid
+// metaball contribution of a particle at distance d < cutoff (0 beyond it)
+enum class Falloff
+{
+    Inverse, // radius / d, as in the exact sum but truncated at the cutoff
+    Compact  // radius / d * (1 - d^2 / cutoff^2)^2, reaches 0 smoothly at the cutoff
+};
+
+// Scalar field sampled on a regular lattice, storing values of type T (float,
+// double, Half or uint16, see ScalarTraits). Fills compute in float and store
+// into T; the tile statistics and the marcher read T directly.
+template <typename T>
+class BasicGrid
 {
 private:
-    // initialize grid of points
-    unsigned int m_resolution;
-    std::vector<Point> m_points;
-    std::vector<float> m_values;
+    using compute_type = typename ScalarTraits<T>::compute_type;
+
+    // node (x_i, y_i) sits at m_origin + (x_i * m_dx, y_i * m_dy); positions are not stored
+    unsigned int m_resolution; // nodes per row
+    unsigned int m_rows;       // rows of nodes, == m_resolution unless mapped
+    unsigned int m_stride;     // values between the starts of consecutive rows
+    glm::vec2 m_origin { 0.0f, 0.0f };
+    float m_dx { 0.0f };
+    float m_dy { 0.0f };
+    std::vector<T> m_values;
+    // when valid, holds the values in place of m_values
+    BasicMappedRaster<T> m_raster;
+
+    // only built if points() is called
+    mutable std::vector<Point> m_points;
+
+    // change tracking: every tile of tile_size x tile_size cells carries the
+    // version at which one of its corner values last changed
+    unsigned int m_tiles_x { 0 };
+    unsigned int m_tiles_y { 0 };
+    std::uint64_t m_version { 0 };
+    std::vector<std::uint64_t> m_tile_versions;
+
+    void markDirtyArea(const glm::vec2& min, const glm::vec2& max);
+
+    // value range of every tile (its corner nodes included) at level 0, and of
+    // 2x2 blocks of the level below at every coarser level, up to a single root;
+    // brought up to date on first use after a change (not thread safe)
+    struct ValueRange
+    {
+        compute_type min, max;
+    };
+    mutable std::vector<std::vector<ValueRange>> m_range_levels;
+    std::vector<unsigned int> m_level_widths;
+    std::vector<unsigned int> m_level_heights;
+    // tiles marked dirty after this version have stale ranges
+    mutable std::uint64_t m_ranges_version { 0 };
+    // activeTiles() descent, kept so repeated queries do not allocate
+    struct RangeBlock
+    {
+        unsigned int level, x, y;
+    };
+    mutable std::vector<RangeBlock> m_range_stack;
+
+    void updateRanges() const;
     
     // for metaballs
-    bool m_walls;
+    bool m_walls { false };
+    SpatialHash m_particle_hash;
+    std::vector<glm::vec2> m_particle_positions;
+    std::vector<float> m_particle_radii;
+    // what the values hold when they are the cutoff fill over the recorded particles; any other
+    // write (a fill, setValue, markDirty) clears it, so the next cutoff fill marks everything
+    struct CutoffFill
+    {
+        float cutoff;
+        Falloff falloff;
+        bool walls;
+    };
+    bool m_cutoff_filled { false };
+    CutoffFill m_cutoff_fill { 0.0f, Falloff::Inverse, false };
 
-    void createPoints(const float width, const float height);
+    void computeSpacing(const float width, const float height);
+    void computeTiles();
+
+    // exact metaball sum of `count` particles at every node
+    void sumParticles(const glm::vec2* positions, const float* radii, const std::size_t count);
+    // the cutoff fill over the particles, recorded in m_particle_positions/m_particle_radii; if the
+    // values are still the same cutoff fill, the record step marks the tiles around every particle
+    // that moved since then dirty, otherwise everything is
+    bool beginParticles(const std::size_t count, const float cutoff, const Falloff falloff);
+    void recordParticle(const std::size_t i, const glm::vec2& position, const float radius, const bool mark);
+    // bins the recorded particles, unless `bins` already holds them (in any bin size), and
+    // rewrites the nodes of the tiles marked dirty after version `since`
+    void sumParticlesWithin(const float cutoff, const Falloff falloff, const std::uint64_t since, const SpatialHash* bins = nullptr);
 public:
-    Grid(const float width, const float height, const unsigned int resolution, float (*f)(const glm::vec2&));
-    Grid(const float width, const float height, const unsigned int resolution, float (*f)(const glm::vec2&, const float));
-    Grid(const float width, const float height, const unsigned int resolution, const bool walls, std::vector<Particle>& particles);
-    Grid(const float width, const float height, const unsigned int resolution, const PerlinNoise& perlin);
+    static constexpr unsigned int tile_size { 32 };
+
+    using value_type = T;
+
+    BasicGrid(const float width, const float height, const unsigned int resolution, float (*f)(const glm::vec2&));
+    BasicGrid(const float width, const float height, const unsigned int resolution, float (*f)(const glm::vec2&, const float));
+    BasicGrid(const float width, const float height, const unsigned int resolution, const bool walls, const std::vector<Particle>& particles);
+    BasicGrid(const float width, const float height, const unsigned int resolution, const bool walls, const Particles& particles);
+    BasicGrid(const float width, const float height, const unsigned int resolution, const PerlinNoise& perlin);
+    // one node per raster sample; the march and the tile statistics read the mapping in place
+    BasicGrid(BasicMappedRaster<T>&& raster, const glm::vec2& origin, const float dx, const float dy);
+    // `resolution` x `rows` nodes at origin + (x_i * dx, y_i * dy), all zero until written through data()
+    BasicGrid(const unsigned int resolution, const unsigned int rows, const glm::vec2& origin, const float dx, const float dy);
 
     void assignValues(float (*f)(const glm::vec2&));
     void assignValues(float (*f)(const glm::vec2&, const float t), const float t);
-    void assignValues(std::vector<Particle>& particles);
+    void assignValues(const std::vector<Particle>& particles);
+    // only sums particles within `cutoff` of each node, binned in a spatial hash; a cutoff that is
+    // not positive and finite is reported on stderr and the exact sum is used instead
+    void assignValues(const std::vector<Particle>& particles, const float cutoff, const Falloff falloff = Falloff::Inverse);
+    // the same fills, reading the particle arrays in place; the cutoff fill uses Particles::hash() when it has one
+    void assignValues(const Particles& particles);
+    void assignValues(const Particles& particles, const float cutoff, const Falloff falloff = Falloff::Inverse);
     void assignValues(const PerlinNoise& perlin, const float t);
 
-    unsigned int size() { return m_resolution * m_resolution; }
+    unsigned int size() const { return m_resolution * m_rows; }
     unsigned int resolution() const { return m_resolution; }
-    const std::vector<Point>& points() const { return m_points; }
-    const std::vector<float>& values() const { return m_values; }
-    void setValue(float val, unsigned int idx) { m_values[idx] = val; }
+    unsigned int rows() const { return m_rows; }
+    unsigned int stride() const { return m_stride; }
+    bool mapped() const { return m_raster.valid(); }
+    const glm::vec2& origin() const { return m_origin; }
+    float dx() const { return m_dx; }
+    float dy() const { return m_dy; }
+
+    float x(const unsigned int x_i) const { return m_origin.x + static_cast<float>(x_i) * m_dx; }
+    float y(const unsigned int y_i) const { return m_origin.y + static_cast<float>(y_i) * m_dy; }
+    // idx addresses data(): y_i * stride() + x_i
+    glm::vec2 position(const unsigned int idx) const { return glm::vec2(x(idx % m_stride), y(idx / m_stride)); }
+
+    // compatibility: materializes every node position, rows packed, on first use (not thread safe)
+    const std::vector<Point>& points() const;
+    // owned values; empty for a mapped grid, see data()
+    const std::vector<T>& values() const { return m_values; }
+    // the value array, owned or mapped, rows stride() apart
+    const T* data() const { return m_raster.valid() ? m_raster.data() : m_values.data(); }
+    T* data() { return m_raster.valid() ? m_raster.data() : m_values.data(); }
+    void setValue(T val, unsigned int idx);
+
+    // nodes [x_begin, x_end) x [y_begin, y_end) changed; every fill marks what it rewrote
+    void markDirty(const unsigned int x_begin, const unsigned int y_begin, const unsigned int x_end, const unsigned int y_end);
+    void markAllDirty();
+    unsigned int tilesX() const { return m_tiles_x; }
+    unsigned int tilesY() const { return m_tiles_y; }
+    std::uint64_t tileVersion(const unsigned int tile) const { return m_tile_versions[tile]; }
+
+    // bounds on the values of a tile's nodes
+    compute_type tileMin(const unsigned int tile) const { updateRanges(); return m_range_levels[0][tile].min; }
+    compute_type tileMax(const unsigned int tile) const { updateRanges(); return m_range_levels[0][tile].max; }
+    // tiles whose range has min < isolevel <= max, i.e. that may hold a contour, in ascending order
+    void activeTiles(const compute_type isolevel, std::vector<unsigned int>& tiles) const;
 };
+
+using Grid = BasicGrid<float>;
@@ -0,0 +1,203 @@
+#include "MappedRaster.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    // Grid and the marchers address nodes as y_i * stride + x_i in unsigned int
+    bool indexable(const std::size_t stride, const std::size_t height)
+    {
+        return height <= std::numeric_limits<unsigned int>::max() / stride;
+    }
+}
+
+template <typename T>
+BasicMappedRaster<T>::BasicMappedRaster(const std::string& npy_path)
+{
+    if (!map(npy_path)) { return; }
+
+    // magic, version, header length, then a python dict literal padded with spaces
+    const unsigned char* bytes { static_cast<const unsigned char*>(m_mapping) };
+    if (m_mapping_size < 10 || std::memcmp(bytes, "\x93NUMPY", 6) != 0)
+    {
+        std::cerr << npy_path << ": not an .npy file\n";
+        unmap();
+        return;
+    }
+    const bool long_header { bytes[6] >= 2 };
+    const std::size_t header_start { long_header ? 12u : 10u };
+    const std::size_t header_size { long_header
+        ? static_cast<std::size_t>(bytes[8]) | static_cast<std::size_t>(bytes[9]) << 8 | static_cast<std::size_t>(bytes[10]) << 16 | static_cast<std::size_t>(bytes[11]) << 24
+        : static_cast<std::size_t>(bytes[8]) | static_cast<std::size_t>(bytes[9]) << 8 };
+    if (header_start + header_size > m_mapping_size)
+    {
+        std::cerr << npy_path << ": truncated header\n";
+        unmap();
+        return;
+    }
+    const std::string header { reinterpret_cast<const char*>(bytes + header_start), header_size };
+
+    const std::string descr { std::string("'") + ScalarTraits<T>::npy_descr + "'" };
+    const std::size_t shape { header.find("'shape'") };
+    const std::size_t open { header.find('(', shape) };
+    if (header.find(descr) == std::string::npos || header.find("'fortran_order': False") == std::string::npos
+        || shape == std::string::npos || open == std::string::npos)
+    {
+        std::cerr << npy_path << ": expected a C order " << ScalarTraits<T>::npy_descr << " array\n";
+        unmap();
+        return;
+    }
+    char* end { nullptr };
+    const unsigned long height { std::strtoul(header.c_str() + open + 1, &end, 10) };
+    const unsigned long width { *end == ',' ? std::strtoul(end + 1, &end, 10) : 0 };
+    const std::size_t data_offset { header_start + header_size };
+    if (width == 0 || height == 0 || *end != ')' || data_offset + width * height * sizeof(T) > m_mapping_size)
+    {
+        std::cerr << npy_path << ": expected a non-empty 2D shape that fits in the file\n";
+        unmap();
+        return;
+    }
+    if (!indexable(width, height))
+    {
+        std::cerr << npy_path << ": " << width << " x " << height << " values, too many to index\n";
+        unmap();
+        return;
+    }
+
+    // the format pads the header so the data is 64 byte aligned
+    m_data = reinterpret_cast<T*>(static_cast<unsigned char*>(m_mapping) + data_offset);
+    m_width = static_cast<unsigned int>(width);
+    m_height = static_cast<unsigned int>(height);
+    m_stride = m_width;
+}
+
+template <typename T>
+BasicMappedRaster<T>::BasicMappedRaster(const std::string& raw_path, const unsigned int width, const unsigned int stride, const std::size_t offset)
+{
+    const unsigned int row_stride { stride == 0 ? width : stride };
+    if (width == 0 || row_stride < width)
+    {
+        std::cerr << raw_path << ": expected 0 < width <= stride, got width " << width << ", stride " << row_stride << '\n';
+        return;
+    }
+    if (offset % alignof(T) != 0)
+    {
+        std::cerr << raw_path << ": offset " << offset << " is not a multiple of " << alignof(T) << " bytes\n";
+        return;
+    }
+    if (!map(raw_path)) { return; }
+
+    // a last row only needs `width` values, not a whole stride
+    const std::size_t available { m_mapping_size > offset ? (m_mapping_size - offset) / sizeof(T) : 0 };
+    const std::size_t height { available >= width ? (available - width) / row_stride + 1 : 0 };
+    if (height == 0)
+    {
+        std::cerr << raw_path << ": smaller than one row\n";
+        unmap();
+        return;
+    }
+    if (!indexable(row_stride, height))
+    {
+        std::cerr << raw_path << ": " << height << " rows of " << row_stride << " values, too many to index\n";
+        unmap();
+        return;
+    }
+
+    m_data = reinterpret_cast<T*>(static_cast<unsigned char*>(m_mapping) + offset);
+    m_width = width;
+    m_height = static_cast<unsigned int>(height);
+    m_stride = row_stride;
+}
+
+template <typename T>
+BasicMappedRaster<T>::~BasicMappedRaster()
+{
+    unmap();
+}
+
+template <typename T>
+BasicMappedRaster<T>::BasicMappedRaster(BasicMappedRaster&& other) noexcept
+    : m_mapping { std::exchange(other.m_mapping, nullptr) }
+    , m_mapping_size { std::exchange(other.m_mapping_size, 0) }
+    , m_data { std::exchange(other.m_data, nullptr) }
+    , m_width { std::exchange(other.m_width, 0) }
+    , m_height { std::exchange(other.m_height, 0) }
+    , m_stride { std::exchange(other.m_stride, 0) }
+{
+}
+
+template <typename T>
+BasicMappedRaster<T>& BasicMappedRaster<T>::operator=(BasicMappedRaster&& other) noexcept
+{
+    if (this != &other)
+    {
+        unmap();
+        m_mapping = std::exchange(other.m_mapping, nullptr);
+        m_mapping_size = std::exchange(other.m_mapping_size, 0);
+        m_data = std::exchange(other.m_data, nullptr);
+        m_width = std::exchange(other.m_width, 0);
+        m_height = std::exchange(other.m_height, 0);
+        m_stride = std::exchange(other.m_stride, 0);
+    }
+    return *this;
+}
+
+template <typename T>
+bool BasicMappedRaster<T>::map(const std::string& path)
+{
+    const int fd { ::open(path.c_str(), O_RDONLY) };
+    if (fd < 0)
+    {
+        std::cerr << path << ": cannot open\n";
+        return false;
+    }
+
+    struct stat info {};
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        std::cerr << path << ": empty or unreadable\n";
+        ::close(fd);
+        return false;
+    }
+
+    // private and writable: Grid::setValue and the fills write to copied pages, never to the file
+    const std::size_t size { static_cast<std::size_t>(info.st_size) };
+    void* mapping { ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) };
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << path << ": mmap failed\n";
+        return false;
+    }
+
+    m_mapping = mapping;
+    m_mapping_size = size;
+    return true;
+}
+
+template <typename T>
+void BasicMappedRaster<T>::unmap()
+{
+    if (m_mapping) { ::munmap(m_mapping, m_mapping_size); }
+    m_mapping = nullptr;
+    m_mapping_size = 0;
+    m_data = nullptr;
+    m_width = 0;
+    m_height = 0;
+    m_stride = 0;
+}
+
+template class BasicMappedRaster<float>;
+template class BasicMappedRaster<double>;
+template class BasicMappedRaster<Half>;
+template class BasicMappedRaster<std::uint16_t>;
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "../Scalar/Scalar.hpp"
+
+// A raster of T (float, double, Half or uint16) memory-mapped straight from
+// disk. Pages are only read in when touched and writes stay private to the
+// process (copy on write), so a Grid can use the mapping as its value array
+// without a load pass. Nodes are indexed in unsigned int, so rasters of
+// 2^32 or more values (rows times stride) are rejected.
+template <typename T>
+class BasicMappedRaster
+{
+private:
+    void* m_mapping { nullptr };
+    std::size_t m_mapping_size { 0 };
+    T* m_data { nullptr };
+    unsigned int m_width { 0 };
+    unsigned int m_height { 0 };
+    unsigned int m_stride { 0 };
+
+    bool map(const std::string& path);
+    void unmap();
+
+public:
+    BasicMappedRaster() = default;
+    // .npy file holding a C order array of shape (height, width) whose dtype matches T (ScalarTraits::npy_descr)
+    explicit BasicMappedRaster(const std::string& npy_path);
+    // raw native endian rows of `stride` values (0: packed), starting `offset` bytes in;
+    // the height is whatever fits in the file
+    BasicMappedRaster(const std::string& raw_path, const unsigned int width, const unsigned int stride = 0, const std::size_t offset = 0);
+    ~BasicMappedRaster();
+
+    BasicMappedRaster(const BasicMappedRaster&) = delete;
+    BasicMappedRaster& operator=(const BasicMappedRaster&) = delete;
+    BasicMappedRaster(BasicMappedRaster&& other) noexcept;
+    BasicMappedRaster& operator=(BasicMappedRaster&& other) noexcept;
+
+    // false if the file could not be mapped or parsed, or is too large to index
+    bool valid() const { return m_data != nullptr; }
+
+    T* data() { return m_data; }
+    const T* data() const { return m_data; }
+    unsigned int width() const { return m_width; }
+    unsigned int height() const { return m_height; }
+    // values between the starts of consecutive rows
+    unsigned int stride() const { return m_stride; }
+};
+
+using MappedRaster = BasicMappedRaster<float>;
@@ -0,0 +1,470 @@
+#include "MarchingCubes.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <iostream>
+#include "../MarchingSquares/MarchingSquares.hpp"
+#include "../MarchingSquares/MarchingSquaresKernels.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+    // marks an index that refers to the previous slab's crossing on its top plane
+    const unsigned int seam_flag { 1u << 31 };
+
+    // bit i: node i + 1 of the mask row, i.e. the row shifted down one node, carrying in the next word
+    inline std::uint64_t nextNodes(const std::uint64_t* row, const unsigned int w, const unsigned int words)
+    {
+        return row[w] >> 1 | (w + 1 < words ? row[w + 1] << 63 : 0);
+    }
+
+    // bits of word w below `count`
+    inline std::uint64_t lowBits(const unsigned int count, const unsigned int w)
+    {
+        return count >= (w + 1) * 64 ? ~std::uint64_t { 0 } : count <= w * 64 ? 0 : (std::uint64_t { 1 } << (count - w * 64)) - 1;
+    }
+
+    // Cube corner c sits at (c & 1, c >> 1 & 1, c >> 2 & 1) from the cell's first node
+    // and is bit c of the case index. Edge axis * 4 + k joins the corners that differ
+    // in bit `axis`, k counting the corner pairs of that axis in ascending order.
+    constexpr unsigned int cubeEdge(const unsigned int c0, const unsigned int c1)
+    {
+        const unsigned int axis { (c0 ^ c1) == 1 ? 0u : (c0 ^ c1) == 2 ? 1u : 2u };
+        const unsigned int base { std::min(c0, c1) };
+        return axis * 4 + ((base & ((1u << axis) - 1)) | (base >> (axis + 1)) << axis);
+    }
+
+    constexpr unsigned int edgeBase(const unsigned int edge)
+    {
+        const unsigned int axis { edge / 4 };
+        const unsigned int k { edge % 4 };
+        return (k & ((1u << axis) - 1)) | (k >> axis) << (axis + 1);
+    }
+
+    // triangles of a case as triples of cube edges
+    struct CubeCase
+    {
+        unsigned char count;
+        unsigned char edges[15];
+    };
+
+    // Derives all 256 cases instead of tabulating them. On each face, segments run
+    // between the crossed edges so as to join the active corners through the face
+    // centre (as SaddlePolicy::Active does in 2D); that choice only depends on the
+    // face, so neighbouring cells agree on it and the surface is closed. Walking the
+    // faces counter-clockwise from outside, each segment leaves an active corner and
+    // enters the next crossed edge, so the segments chain into loops around the
+    // active region, which are fanned into triangles.
+    constexpr std::array<CubeCase, 256> buildCubeCases()
+    {
+        std::array<CubeCase, 256> cases {};
+        for (unsigned int index = 0; index < 256; ++index)
+        {
+            int next[12] { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+            for (unsigned int axis = 0; axis < 3; ++axis)
+            {
+                // (u, v, axis) right handed
+                const unsigned int u { (axis + 1) % 3 };
+                const unsigned int v { (axis + 2) % 3 };
+                for (unsigned int side = 0; side < 2; ++side)
+                {
+                    // counter-clockwise seen from outside, i.e. against the face normal
+                    constexpr unsigned int ccw[4][2] { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+                    unsigned int corners[4] {};
+                    for (unsigned int k = 0; k < 4; ++k)
+                    {
+                        const unsigned int cu { side ? ccw[k][0] : ccw[k][1] };
+                        const unsigned int cv { side ? ccw[k][1] : ccw[k][0] };
+                        corners[k] = side << axis | cu << u | cv << v;
+                    }
+
+                    for (unsigned int k = 0; k < 4; ++k)
+                    {
+                        const bool from { (index >> corners[k] & 1) != 0 };
+                        const bool to { (index >> corners[(k + 1) % 4] & 1) != 0 };
+                        if (!from || to) { continue; }
+
+                        for (unsigned int m = 1; m < 4; ++m)
+                        {
+                            const unsigned int a { corners[(k + m) % 4] };
+                            const unsigned int b { corners[(k + m + 1) % 4] };
+                            if ((index >> a & 1) != (index >> b & 1))
+                            {
+                                next[cubeEdge(corners[k], corners[(k + 1) % 4])] = static_cast<int>(cubeEdge(a, b));
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+
+            CubeCase& cube_case { cases[index] };
+            bool visited[12] {};
+            for (unsigned int start = 0; start < 12; ++start)
+            {
+                if (next[start] < 0 || visited[start]) { continue; }
+
+                unsigned int loop[12] {};
+                unsigned int length { 0 };
+                for (unsigned int e = start; !visited[e]; e = static_cast<unsigned int>(next[e]))
+                {
+                    visited[e] = true;
+                    loop[length++] = e;
+                }
+
+                // the loop circles the active region counter-clockwise; reversing it
+                // makes the triangles face the inactive side
+                for (unsigned int i = 1; i + 1 < length; ++i)
+                {
+                    cube_case.edges[cube_case.count++] = static_cast<unsigned char>(loop[0]);
+                    cube_case.edges[cube_case.count++] = static_cast<unsigned char>(loop[i + 1]);
+                    cube_case.edges[cube_case.count++] = static_cast<unsigned char>(loop[i]);
+                }
+            }
+        }
+        return cases;
+    }
+
+    constexpr std::array<CubeCase, 256> cube_cases { buildCubeCases() };
+
+    static_assert(cube_cases[0].count == 0 && cube_cases[255].count == 0);
+    static_assert(cube_cases[1].count == 3 && cube_cases[254].count == 3);
+}
+
+MarchingCubes::MarchingCubes(const float isolevel, const bool interp, const Volume& volume)
+    : m_isolevel { isolevel }
+    , m_interp { interp }
+    , m_vertices {}
+    , m_indices {}
+    , m_volume { volume }
+    , m_slabs {}
+{
+    march(volume);
+}
+
+void MarchingCubes::march(const Volume& volume)
+{
+    clear();
+
+    if (volume.nx() < 2 || volume.ny() < 2 || volume.nz() < 2)
+    {
+        trackBuffers();
+        return;
+    }
+    if (2 * static_cast<std::size_t>(volume.nx()) * volume.ny() > seam_flag)
+    {
+        std::cerr << "MarchingCubes: volume planes too large to index\n";
+        trackBuffers();
+        return;
+    }
+
+#ifdef _OPENMP
+    const unsigned int threads { m_threads == 0 ? static_cast<unsigned int>(omp_get_max_threads()) : m_threads };
+#else
+    const unsigned int threads { 1 };
+#endif
+
+    // a few slabs per thread balances uneven surface density, and concatenating
+    // them in slab order reproduces the serial vertex order exactly
+    const unsigned int layers { volume.nz() - 1 };
+    const unsigned int slab_count { threads > 1 ? std::min(layers, 4 * threads) : 1 };
+    if (m_slabs.size() < slab_count) { m_slabs.resize(slab_count); }
+
+    #pragma omp parallel for schedule(dynamic) num_threads(threads)
+    for (unsigned int s = 0; s < slab_count; ++s)
+    {
+        marchSlab(layers * s / slab_count, layers * (s + 1) / slab_count, s > 0, m_slabs[s]);
+    }
+
+    // stitch
+    std::vector<std::size_t>& offsets { m_slab_offsets };
+    std::vector<std::size_t>& index_offsets { m_slab_index_offsets };
+    offsets.assign(slab_count + 1, 0);
+    index_offsets.assign(slab_count + 1, 0);
+    for (unsigned int s = 0; s < slab_count; ++s)
+    {
+        offsets[s + 1] = offsets[s] + m_slabs[s].vertices.size();
+        index_offsets[s + 1] = index_offsets[s] + m_slabs[s].indices.size();
+    }
+    m_vertices.resize(offsets[slab_count]);
+    m_indices.resize(index_offsets[slab_count]);
+
+    const unsigned int plane_size { volume.nx() * volume.ny() };
+
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (unsigned int s = 0; s < slab_count; ++s)
+    {
+        const Slab& slab { m_slabs[s] };
+        std::copy(slab.vertices.begin(), slab.vertices.end(), m_vertices.begin() + static_cast<std::ptrdiff_t>(offsets[s]));
+
+        // local vertex ids to global ones; seam ids resolve to the previous slab's
+        // crossings on its top plane (left in below_x/below_y by the final swap)
+        unsigned int* out { m_indices.data() + index_offsets[s] };
+        const unsigned int offset { static_cast<unsigned int>(offsets[s]) };
+        for (const unsigned int id : slab.indices)
+        {
+            if (id & seam_flag)
+            {
+                const unsigned int edge { id & ~seam_flag };
+                const Slab& prev { m_slabs[s - 1] };
+                *out++ = (edge < plane_size ? prev.below_x[edge] : prev.below_y[edge - plane_size]) + static_cast<unsigned int>(offsets[s - 1]);
+            }
+            else
+            {
+                *out++ = id + offset;
+            }
+        }
+    }
+
+    trackBuffers();
+}
+
+void MarchingCubes::trackBuffers()
+{
+    m_buffers.add(m_vertices);
+    m_buffers.add(m_indices);
+    m_buffers.add(m_slabs);
+    for (const Slab& slab : m_slabs)
+    {
+        m_buffers.add(slab.vertices);
+        m_buffers.add(slab.indices);
+        for (const std::vector<unsigned int>* ids : { &slab.below_x, &slab.below_y, &slab.above_x, &slab.above_y, &slab.layer_z })
+        {
+            m_buffers.add(*ids);
+        }
+        m_buffers.add(slab.below_active);
+        m_buffers.add(slab.above_active);
+    }
+    m_buffers.add(m_slab_offsets);
+    m_buffers.add(m_slab_index_offsets);
+    m_buffers.finish();
+}
+
+void MarchingCubes::marchSlab(const unsigned int z_begin, const unsigned int z_end, const bool seam_below, Slab& slab) const
+{
+    const std::size_t plane_size { static_cast<std::size_t>(m_volume.nx()) * m_volume.ny() };
+    slab.vertices.clear();
+    slab.indices.clear();
+    for (std::vector<unsigned int>* ids : { &slab.below_x, &slab.below_y, &slab.above_x, &slab.above_y, &slab.layer_z })
+    {
+        ids->resize(plane_size);
+    }
+    slab.below_active.resize(static_cast<std::size_t>(words()) * m_volume.ny());
+    slab.above_active.resize(static_cast<std::size_t>(words()) * m_volume.ny());
+
+    classifyPlane(z_begin, slab.below_active);
+    planeCrossings(z_begin, seam_below, slab.below_active, slab, slab.below_x, slab.below_y);
+
+    for (unsigned int z_i = z_begin; z_i < z_end; ++z_i)
+    {
+        classifyPlane(z_i + 1, slab.above_active);
+        layerCrossings(z_i, slab);
+        planeCrossings(z_i + 1, false, slab.above_active, slab, slab.above_x, slab.above_y);
+        triangulateLayer(slab);
+
+        // this layer's top plane is the next one's bottom
+        std::swap(slab.below_x, slab.above_x);
+        std::swap(slab.below_y, slab.above_y);
+        std::swap(slab.below_active, slab.above_active);
+    }
+}
+
+bool MarchingCubes::active(const float value) const
+{
+    return !(value < m_isolevel);
+}
+
+glm::vec3 MarchingCubes::crossing(const glm::vec3& active_pos, const glm::vec3& inactive_pos, const float active_value, const float inactive_value) const
+{
+    return edgeCrossing(active_pos, inactive_pos, active_value, inactive_value, m_isolevel, m_interp);
+}
+
+void MarchingCubes::addCrossing(const std::size_t a, const std::size_t b, const glm::vec3& a_pos, const glm::vec3& b_pos,
+                                std::vector<glm::vec3>& vertices, unsigned int& id) const
+{
+    const float* values { m_volume.data() };
+    id = static_cast<unsigned int>(vertices.size());
+    vertices.push_back(active(values[a])
+        ? crossing(a_pos, b_pos, values[a], values[b])
+        : crossing(b_pos, a_pos, values[b], values[a]));
+}
+
+void MarchingCubes::classifyPlane(const unsigned int z_i, std::vector<std::uint64_t>& active_nodes) const
+{
+    const ClassifyRowKernel classify { selectClassifyRowKernel() };
+    const unsigned int nx { m_volume.nx() };
+    for (unsigned int y_i = 0; y_i < m_volume.ny(); ++y_i)
+    {
+        classify(m_volume.data() + m_volume.index(0, y_i, z_i), nx, m_isolevel, active_nodes.data() + static_cast<std::size_t>(y_i) * words());
+    }
+}
+
+void MarchingCubes::planeCrossings(const unsigned int z_i, const bool seam, const std::vector<std::uint64_t>& active_nodes, Slab& slab,
+                                   std::vector<unsigned int>& x_ids, std::vector<unsigned int>& y_ids) const
+{
+    const unsigned int nx { m_volume.nx() };
+    const unsigned int ny { m_volume.ny() };
+    const unsigned int row_words { words() };
+    const unsigned int plane_size { nx * ny };
+    const std::size_t plane_offset { m_volume.index(0, 0, z_i) };
+    const float z { m_volume.z(z_i) };
+
+    // row major, x edges before y edges of each row
+    for (unsigned int y_i = 0; y_i < ny; ++y_i)
+    {
+        const std::uint64_t* row { active_nodes.data() + static_cast<std::size_t>(y_i) * row_words };
+        const unsigned int row_offset { y_i * nx };
+        const float y { m_volume.y(y_i) };
+
+        for (unsigned int w = 0; w < row_words; ++w)
+        {
+            std::uint64_t crossed { (row[w] ^ nextNodes(row, w, row_words)) & lowBits(nx - 1, w) };
+            for (; crossed; crossed &= crossed - 1)
+            {
+                const unsigned int x_i { w * 64 + static_cast<unsigned int>(std::countr_zero(crossed)) };
+                const unsigned int i { row_offset + x_i };
+                if (seam) { x_ids[i] = seam_flag | i; continue; }
+                addCrossing(plane_offset + i, plane_offset + i + 1, glm::vec3(m_volume.x(x_i), y, z), glm::vec3(m_volume.x(x_i + 1), y, z), slab.vertices, x_ids[i]);
+            }
+        }
+
+        if (y_i + 1 == ny) { continue; }
+        const float y_next { m_volume.y(y_i + 1) };
+        for (unsigned int w = 0; w < row_words; ++w)
+        {
+            std::uint64_t crossed { row[w] ^ row[w + row_words] };
+            for (; crossed; crossed &= crossed - 1)
+            {
+                const unsigned int x_i { w * 64 + static_cast<unsigned int>(std::countr_zero(crossed)) };
+                const unsigned int i { row_offset + x_i };
+                if (seam) { y_ids[i] = seam_flag | (plane_size + i); continue; }
+                const float x { m_volume.x(x_i) };
+                addCrossing(plane_offset + i, plane_offset + i + nx, glm::vec3(x, y, z), glm::vec3(x, y_next, z), slab.vertices, y_ids[i]);
+            }
+        }
+    }
+}
+
+void MarchingCubes::layerCrossings(const unsigned int z_i, Slab& slab) const
+{
+    const unsigned int nx { m_volume.nx() };
+    const unsigned int ny { m_volume.ny() };
+    const unsigned int row_words { words() };
+    const std::size_t below_offset { m_volume.index(0, 0, z_i) };
+    const std::size_t above_offset { m_volume.index(0, 0, z_i + 1) };
+    const float z { m_volume.z(z_i) };
+    const float z_next { m_volume.z(z_i + 1) };
+
+    for (unsigned int y_i = 0; y_i < ny; ++y_i)
+    {
+        const std::size_t row { static_cast<std::size_t>(y_i) * row_words };
+        const float y { m_volume.y(y_i) };
+        for (unsigned int w = 0; w < row_words; ++w)
+        {
+            std::uint64_t crossed { slab.below_active[row + w] ^ slab.above_active[row + w] };
+            for (; crossed; crossed &= crossed - 1)
+            {
+                const unsigned int x_i { w * 64 + static_cast<unsigned int>(std::countr_zero(crossed)) };
+                const unsigned int i { y_i * nx + x_i };
+                const float x { m_volume.x(x_i) };
+                addCrossing(below_offset + i, above_offset + i, glm::vec3(x, y, z), glm::vec3(x, y, z_next), slab.vertices, slab.layer_z[i]);
+            }
+        }
+    }
+}
+
+void MarchingCubes::triangulateLayer(Slab& slab) const
+{
+    const unsigned int nx { m_volume.nx() };
+    const unsigned int ny { m_volume.ny() };
+    const unsigned int row_words { words() };
+
+    // the edge id arrays by cube edge, see cubeEdge
+    const unsigned int* ids[12] {
+        slab.below_x.data(), slab.below_x.data(), slab.above_x.data(), slab.above_x.data(),
+        slab.below_y.data(), slab.below_y.data(), slab.above_y.data(), slab.above_y.data(),
+        slab.layer_z.data(), slab.layer_z.data(), slab.layer_z.data(), slab.layer_z.data()
+    };
+    // and the offset of each edge's first node from the cell's first node, within its plane
+    unsigned int offsets[12] {};
+    for (unsigned int e = 0; e < 12; ++e)
+    {
+        const unsigned int base { edgeBase(e) };
+        offsets[e] = (base & 1) + (base >> 1 & 1) * nx;
+    }
+
+    for (unsigned int y_i = 0; y_i + 1 < ny; ++y_i)
+    {
+        const std::uint64_t* below_near { slab.below_active.data() + static_cast<std::size_t>(y_i) * row_words };
+        const std::uint64_t* below_far { below_near + row_words };
+        const std::uint64_t* above_near { slab.above_active.data() + static_cast<std::size_t>(y_i) * row_words };
+        const std::uint64_t* above_far { above_near + row_words };
+
+        for (unsigned int w = 0; w < row_words; ++w)
+        {
+            // bit i of corner[c]: cube corner c of cell w * 64 + i
+            const std::uint64_t corner[8] {
+                below_near[w], nextNodes(below_near, w, row_words), below_far[w], nextNodes(below_far, w, row_words),
+                above_near[w], nextNodes(above_near, w, row_words), above_far[w], nextNodes(above_far, w, row_words)
+            };
+
+            // a cell is uniform if every corner matches corner 0
+            std::uint64_t mixed { 0 };
+            for (unsigned int c = 1; c < 8; ++c) { mixed |= corner[0] ^ corner[c]; }
+            mixed &= lowBits(nx - 1, w);
+
+            for (; mixed; mixed &= mixed - 1)
+            {
+                const unsigned int bit { static_cast<unsigned int>(std::countr_zero(mixed)) };
+                unsigned int index { 0 };
+                for (unsigned int c = 0; c < 8; ++c) { index |= static_cast<unsigned int>(corner[c] >> bit & 1) << c; }
+
+                const unsigned int i { y_i * nx + w * 64 + bit };
+                const CubeCase& cube_case { cube_cases[index] };
+                for (unsigned int k = 0; k < cube_case.count; ++k)
+                {
+                    const unsigned char e { cube_case.edges[k] };
+                    slab.indices.push_back(ids[e][i + offsets[e]]);
+                }
+            }
+        }
+    }
+}
+
+std::vector<float> MarchingCubes::positions() const
+{
+    std::vector<float> positions;
+    this->positions(positions);
+    return positions;
+}
+
+std::size_t MarchingCubes::writePositions(const std::span<float> out) const
+{
+    const std::size_t count { positionCount() };
+    if (out.size() < count) { return count; }
+
+    float* dst { out.data() };
+    for (const glm::vec3& vertex : m_vertices)
+    {
+        *dst++ = vertex.x;
+        *dst++ = vertex.y;
+        *dst++ = vertex.z;
+    }
+
+    return count;
+}
+
+void MarchingCubes::positions(std::vector<float>& out) const
+{
+    out.resize(positionCount());
+    writePositions(out);
+}
+
+void MarchingCubes::clear()
+{
+    m_vertices.clear();
+    m_indices.clear();
+}
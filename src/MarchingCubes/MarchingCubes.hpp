@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../Volume/Volume.hpp"
+#include "../BufferStats/BufferStats.hpp"
+
+// Isosurface of a Volume as an indexed triangle mesh. Every lattice edge
+// crossing becomes one vertex shared by all cells around that edge; triangles
+// wind counter-clockwise seen from the inactive side (below the isolevel), so
+// their normals point down the field.
+//
+// The march runs on z slabs of cell layers in parallel. Each slab creates the
+// crossings of its layers and of the plane above them, referring to the plane
+// below through the previous slab, so the mesh is the same for any thread count.
+class MarchingCubes
+{
+private:
+    float m_isolevel;
+    bool m_interp;
+    unsigned int m_threads { 1 };
+    std::vector<glm::vec3> m_vertices;
+    std::vector<unsigned int> m_indices;
+
+    const Volume& m_volume;
+
+    struct Slab
+    {
+        std::vector<glm::vec3> vertices;
+        std::vector<unsigned int> indices;
+        // vertex ids of the crossings on the x and y edges of the planes below and above
+        // the current cell layer, and on the z edges between them, indexed by the edge's
+        // first node within the plane
+        std::vector<unsigned int> below_x, below_y, above_x, above_y, layer_z;
+        // active() of every node of the two planes, packed as MarchingSquaresKernels masks,
+        // one row of words() words per node row
+        std::vector<std::uint64_t> below_active, above_active;
+    };
+
+    // per-slab output buffers, kept to reuse their capacity
+    std::vector<Slab> m_slabs;
+    // where each slab's vertices and indices start in the stitched mesh
+    std::vector<std::size_t> m_slab_offsets, m_slab_index_offsets;
+
+    BufferTracker m_buffers;
+    void trackBuffers();
+
+    bool active(const float value) const;
+    glm::vec3 crossing(const glm::vec3& active_pos, const glm::vec3& inactive_pos, const float active_value, const float inactive_value) const;
+    void addCrossing(const std::size_t a, const std::size_t b, const glm::vec3& a_pos, const glm::vec3& b_pos,
+                     std::vector<glm::vec3>& vertices, unsigned int& id) const;
+
+    // 64 bit mask words per node row
+    unsigned int words() const { return (m_volume.nx() + 63) / 64; }
+    void classifyPlane(const unsigned int z_i, std::vector<std::uint64_t>& active_nodes) const;
+    // vertices of the crossings on the x and y edges of plane z_i; with `seam` the plane
+    // belongs to the slab before and its crossings only get seam ids
+    void planeCrossings(const unsigned int z_i, const bool seam, const std::vector<std::uint64_t>& active_nodes, Slab& slab,
+                        std::vector<unsigned int>& x_ids, std::vector<unsigned int>& y_ids) const;
+    // vertices of the crossings on the z edges between planes z_i and z_i + 1
+    void layerCrossings(const unsigned int z_i, Slab& slab) const;
+    void triangulateLayer(Slab& slab) const;
+    // marches cell layers [z_begin, z_end); with seam_below the crossings on plane z_begin
+    // belong to the slab before and are referenced as seam ids
+    void marchSlab(const unsigned int z_begin, const unsigned int z_end, const bool seam_below, Slab& slab) const;
+
+public:
+    MarchingCubes(const float isolevel, const bool interp, const Volume& volume);
+
+    void march(const Volume& volume);
+    const std::vector<glm::vec3>& vertices() const { return m_vertices; }
+    // vertex index triples, one per triangle (GL_TRIANGLES)
+    const std::vector<unsigned int>& indices() const { return m_indices; }
+    // vertices as packed x, y, z floats
+    std::vector<float> positions() const;
+    // floats positions() holds: x, y, z per vertex
+    std::size_t positionCount() const { return 3 * m_vertices.size(); }
+    // writes positions() into `out` and returns positionCount(); writes nothing if `out` is too small
+    std::size_t writePositions(std::span<float> out) const;
+    // same, into `out` resized to fit, reusing its capacity
+    void positions(std::vector<float>& out) const;
+    float getIsolevel() const { return m_isolevel; }
+    void setIsolevel(const float isolevel) { m_isolevel = isolevel; }
+
+    // 1 marches serially, 0 uses every available core; the mesh is the same either way
+    unsigned int threads() const { return m_threads; }
+    void setThreads(const unsigned int threads) { m_threads = threads; }
+
+    // capacity held by the mesh and slab buffers after the last march, and how often they grew
+    const BufferStats& bufferStats() const { return m_buffers.stats(); }
+
+    void clear();
+};
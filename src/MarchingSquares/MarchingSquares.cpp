@@ -1,254 +1,628 @@
 #include "MarchingSquares.hpp"
+#include <algorithm>
+#include <bit>
+#include <type_traits>
+#include "MarchingSquaresKernels.hpp"
+#include "../Profiler/Profiler.hpp"
 #include <iostream>
 
-MarchingSquares::MarchingSquares(const float isolevel, const bool interp, const Grid& grid)
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+    // marks an index that refers to the previous band's crossing below its last row, at column (idx & ~seam_flag)
+    const unsigned int seam_flag { 1u << 31 };
+
+    const unsigned int no_link { ~0u };
+
+    void link(std::vector<std::array<unsigned int, 2>>& links, const unsigned int a, const unsigned int b)
+    {
+        // a crossing is shared by at most two cells, so every vertex has at most two neighbours
+        links[a][links[a][0] != no_link] = b;
+        links[b][links[b][0] != no_link] = a;
+    }
+}
+
+template <typename T>
+BasicMarchingSquares<T>::BasicMarchingSquares(const compute_type isolevel, const bool interp, const BasicGrid<T>& grid)
     : m_isolevel { isolevel }
     , m_interp { interp }
-    , m_grid_points { grid.points() }
-    , m_grid_values {  grid.values() }
+    , m_grid { grid }
+    , m_grid_values { grid.data() }
 {
     march(grid);
 }
 
-void MarchingSquares::march(const Grid& grid)
+template <typename T>
+void BasicMarchingSquares<T>::march(const BasicGrid<T>& grid)
 {
+    PROFILE_ZONE("MarchingSquares::march");
     clear();
-    
-    // row major order
-    m_state = { active(m_grid_values[0]), 0, 0, active(m_grid_values[grid.resolution()]) };
 
-    for (unsigned int y_i = 0; y_i < grid.resolution()-1; ++y_i)
+    if (grid.resolution() < 2 || grid.rows() < 2)
     {
-        for (unsigned int x_i = 0; x_i < grid.resolution()-1; ++x_i)
-        {
-            unsigned int row_offset { grid.resolution() * y_i };
-            unsigned int nw_idx { row_offset + x_i };
-            unsigned int sw_idx { nw_idx + grid.resolution() };
-            m_state.v1 = active(m_grid_values[nw_idx + 1]); // top right
-            m_state.v2 = active(m_grid_values[sw_idx + 1]); // bottom right
+        trackBuffers();
+        return;
+    }
+    m_grid_values = grid.data();
 
-            // std::cout << m_state.v0 << m_state.v1 << m_state.v2 << m_state.v3 << '\n';
+#ifdef _OPENMP
+    const unsigned int threads { m_threads == 0 ? static_cast<unsigned int>(omp_get_max_threads()) : m_threads };
+#else
+    const unsigned int threads { 1 };
+#endif
 
-            if (m_state.hasEdge())
-            {
-                addEdgeVertices(
-                    m_state,
-                    {
-                        nw_idx,     // nw
-                        nw_idx + 1, // ne
-                        sw_idx + 1, // se
-                        sw_idx      // sw
-                    }
-                    );
-            }
+    findActiveRuns(grid);
 
-            // set left indices for next iteration
-            if (x_i == grid.resolution()-2)
-            {
-                m_state.v0 = active(m_grid_values[ grid.resolution() * ( y_i + 1 ) ]);
-                m_state.v3 = active(m_grid_values[ grid.resolution() * ( y_i + 2 ) ]);
-            }
-            else
-            {
-                m_state.v0 = m_state.v1;
-                m_state.v3 = m_state.v2;
-            }
-        }
+    if (m_incremental && !indexed())
+    {
+        marchIncremental(grid, threads);
+    }
+    else if (threads > 1)
+    {
+        marchParallel(grid.stride(), threads);
+    }
+    else if (m_polylines)
+    {
+        marchRowsIndexed(grid.stride(), 0, grid.rows() - 1, false, m_points, m_indices, m_above, m_below, &m_links);
+    }
+    else if (m_indexed)
+    {
+        marchRowsIndexed(grid.stride(), 0, grid.rows() - 1, false, m_points, m_indices, m_above, m_below);
     }
+    else
+    {
+        marchActiveRows(grid.stride(), 0, grid.rows() - 1, m_points);
+    }
+
+    if (m_polylines) { buildPolylines(); }
+    trackBuffers();
+    PROFILE_COUNT(Counter::Vertices, m_points.size());
 }
 
-std::vector<float> MarchingSquares::positions()
+template <typename T>
+void BasicMarchingSquares<T>::trackBuffers()
 {
-    std::vector<float> positions;
-    positions.reserve(2 * m_points.size());
-
-    for (const Point& point : m_points)
+    m_buffers.add(m_points);
+    m_buffers.add(m_indices);
+    m_buffers.add(m_links);
+    m_buffers.add(m_polyline_list);
+    m_buffers.add(m_polyline_vertices);
+    m_buffers.add(m_visited);
+    m_buffers.add(m_bands);
+    for (const Band& band : m_bands)
     {
-        const glm::vec2& pos { point.position() };
-
-        positions.push_back(pos.x);
-        positions.push_back(pos.y);
+        m_buffers.add(band.points);
+        m_buffers.add(band.indices);
+        m_buffers.add(band.above);
+        m_buffers.add(band.below);
     }
+    m_buffers.add(m_band_offsets);
+    m_buffers.add(m_band_index_offsets);
+    m_buffers.add(m_tiles);
+    for (const Tile& tile : m_tiles) { m_buffers.add(tile.points); }
+    m_buffers.add(m_stale_tiles);
+    m_buffers.add(m_active_tiles);
+    m_buffers.add(m_runs);
+    m_buffers.add(m_run_offsets);
+    m_buffers.add(m_above);
+    m_buffers.add(m_below);
+    m_buffers.finish();
+}
 
-    return positions;
+template <typename T>
+void BasicMarchingSquares<T>::marchRows(const unsigned int stride, const unsigned int x_begin, const unsigned int x_end,
+                                        const unsigned int y_begin, const unsigned int y_end, std::vector<Point>& points) const
+{
+    // the per vertex interpolation and saddle choices are resolved here, once per call
+    if (m_interp)
+    {
+        if (m_saddle == SaddlePolicy::Average) { marchRowsKernel<true, SaddlePolicy::Average>(stride, x_begin, x_end, y_begin, y_end, points); }
+        else { marchRowsKernel<true, SaddlePolicy::Active>(stride, x_begin, x_end, y_begin, y_end, points); }
+    }
+    else
+    {
+        if (m_saddle == SaddlePolicy::Average) { marchRowsKernel<false, SaddlePolicy::Average>(stride, x_begin, x_end, y_begin, y_end, points); }
+        else { marchRowsKernel<false, SaddlePolicy::Active>(stride, x_begin, x_end, y_begin, y_end, points); }
+    }
 }
 
-float MarchingSquares::lerp(const float a, const float b, const float t)
+template <typename T>
+template <bool Interp, SaddlePolicy Saddle>
+void BasicMarchingSquares<T>::marchRowsKernel(const unsigned int stride, const unsigned int x_begin, const unsigned int x_end,
+                                              const unsigned int y_begin, const unsigned int y_end, std::vector<Point>& points) const
 {
-    return a + t * (b - a);
+    // row major order
+    for (unsigned int y_i = y_begin; y_i < y_end; ++y_i)
+    {
+        const T* top { m_grid_values + stride * y_i };
+        marchRowKernel<Interp, Saddle>(top, top + stride, y_i, x_begin, x_end, points);
+    }
 }
 
-bool MarchingSquares::active(const float value)
+template <typename T>
+template <bool Interp, SaddlePolicy Saddle>
+void BasicMarchingSquares<T>::marchRowKernel(const T* top, const T* bottom, const unsigned int y_i, const unsigned int x_begin, const unsigned int x_end,
+                                             std::vector<Point>& points) const
 {
-    return (value < m_isolevel) ? 0 : 1;
+    forEachCrossedCell(top, bottom, x_begin, x_end, [&](const unsigned int x_i, const unsigned int index)
+    {
+        const EdgeCase& edge_case { edge_cases[emittedCase<Saddle>(index, x_i, top, bottom)] };
+        for (unsigned int e = 0; e < edge_case.count; ++e)
+        {
+            points.push_back(edgePoint<Interp>(edge_case.edges[e], index, x_i, y_i, top, bottom));
+        }
+    });
 }
 
-void MarchingSquares::pushX(unsigned int active_node_idx, unsigned int inactive_node_idx)
+template <typename T>
+void BasicMarchingSquares<T>::marchRow(const T* top, const T* bottom, const unsigned int y_i, std::vector<Point>& points) const
 {
+    if (m_grid.resolution() < 2) { return; }
+    const unsigned int cells { m_grid.resolution() - 1 };
     if (m_interp)
     {
-        m_points.emplace_back(
-            lerp(
-                    m_grid_points[active_node_idx].position().x,
-                    m_grid_points[inactive_node_idx].position().x,
-                    1 - (m_isolevel - m_grid_values[inactive_node_idx]) / (m_grid_values[active_node_idx] - m_grid_values[inactive_node_idx])
-                ),
-                m_grid_points[active_node_idx].position().y
-            );
+        if (m_saddle == SaddlePolicy::Average) { marchRowKernel<true, SaddlePolicy::Average>(top, bottom, y_i, 0, cells, points); }
+        else { marchRowKernel<true, SaddlePolicy::Active>(top, bottom, y_i, 0, cells, points); }
     }
     else
     {
-        m_points.emplace_back( (m_grid_points[active_node_idx].position().x + m_grid_points[inactive_node_idx].position().x) / 2 , m_grid_points[active_node_idx].position().y);
+        if (m_saddle == SaddlePolicy::Average) { marchRowKernel<false, SaddlePolicy::Average>(top, bottom, y_i, 0, cells, points); }
+        else { marchRowKernel<false, SaddlePolicy::Active>(top, bottom, y_i, 0, cells, points); }
+    }
+}
+
+template <typename T>
+void BasicMarchingSquares<T>::marchActiveRows(const unsigned int stride, const unsigned int y_begin, const unsigned int y_end, std::vector<Point>& points) const
+{
+    for (unsigned int y_i = y_begin; y_i < y_end; ++y_i)
+    {
+        const unsigned int tile_row { y_i / BasicGrid<T>::tile_size };
+        for (unsigned int r = m_run_offsets[tile_row]; r < m_run_offsets[tile_row + 1]; ++r)
+        {
+            marchRows(stride, m_runs[r][0], m_runs[r][1], y_i, y_i + 1, points);
+        }
     }
 }
 
-void MarchingSquares::pushY(unsigned int active_node_idx, unsigned int inactive_node_idx)
+template <typename T>
+void BasicMarchingSquares<T>::marchRowsIndexed(const unsigned int stride, const unsigned int y_begin, const unsigned int y_end, const bool seam_above,
+                                               std::vector<Point>& points, std::vector<unsigned int>& indices,
+                                               std::vector<unsigned int>& above, std::vector<unsigned int>& below,
+                                               std::vector<std::array<unsigned int, 2>>* links) const
 {
     if (m_interp)
     {
-        m_points.emplace_back(
-            m_grid_points[active_node_idx].position().x,
-            lerp(
-                    m_grid_points[active_node_idx].position().y,
-                    m_grid_points[inactive_node_idx].position().y,
-                    1 - (m_isolevel - m_grid_values[inactive_node_idx]) / (m_grid_values[active_node_idx] - m_grid_values[inactive_node_idx])
-                )
-            );
+        if (m_saddle == SaddlePolicy::Average) { marchRowsIndexedKernel<true, SaddlePolicy::Average>(stride, y_begin, y_end, seam_above, points, indices, above, below, links); }
+        else { marchRowsIndexedKernel<true, SaddlePolicy::Active>(stride, y_begin, y_end, seam_above, points, indices, above, below, links); }
     }
     else
     {
-        m_points.emplace_back(m_grid_points[active_node_idx].position().x, (m_grid_points[active_node_idx].position().y + m_grid_points[inactive_node_idx].position().y) / 2);
+        if (m_saddle == SaddlePolicy::Average) { marchRowsIndexedKernel<false, SaddlePolicy::Average>(stride, y_begin, y_end, seam_above, points, indices, above, below, links); }
+        else { marchRowsIndexedKernel<false, SaddlePolicy::Active>(stride, y_begin, y_end, seam_above, points, indices, above, below, links); }
     }
 }
 
-void MarchingSquares::top(const StateCell& stateCell)
+template <typename T>
+template <bool Interp, SaddlePolicy Saddle>
+void BasicMarchingSquares<T>::marchRowsIndexedKernel(const unsigned int stride, const unsigned int y_begin, const unsigned int y_end, const bool seam_above,
+                                                     std::vector<Point>& points, std::vector<unsigned int>& indices,
+                                                     std::vector<unsigned int>& above, std::vector<unsigned int>& below,
+                                                     std::vector<std::array<unsigned int, 2>>* links) const
 {
-    unsigned int nw_idx { stateCell.cell.nw };
-    unsigned int ne_idx { stateCell.cell.ne };
+    above.resize(m_grid.resolution() - 1);
+    below.resize(m_grid.resolution() - 1);
 
-    unsigned int active_node_idx { stateCell.state.v0 ? nw_idx : ne_idx };
-    unsigned int inactive_node_idx { stateCell.state.v0 ? ne_idx : nw_idx };
+    for (unsigned int y_i = y_begin; y_i < y_end; ++y_i)
+    {
+        const unsigned int row_offset { stride * y_i };
 
-    pushX(active_node_idx, inactive_node_idx);
-}
+        // crossing on the right edge of the previous cell
+        unsigned int left_edge { 0 };
 
-void MarchingSquares::bottom(const StateCell& stateCell)
-{
-    unsigned int se_idx { stateCell.cell.se };
-    unsigned int sw_idx { stateCell.cell.sw };
+        // a crossing lies on both tiles sharing its edge, so the cells referring
+        // to cached crossings (left, above) are never the first of a skipped run
+        const unsigned int tile_row { y_i / BasicGrid<T>::tile_size };
+        for (unsigned int r = m_run_offsets[tile_row]; r < m_run_offsets[tile_row + 1]; ++r)
+        {
+            const T* top { m_grid_values + row_offset };
+            const T* bottom { top + stride };
+            forEachCrossedCell(top, bottom, m_runs[r][0], m_runs[r][1], [&](const unsigned int x_i, const unsigned int index)
+            {
+                const EdgeCase& edge_case { edge_cases[emittedCase<Saddle>(index, x_i, top, bottom)] };
+                const std::size_t first_index { indices.size() };
 
-    unsigned int active_node_idx { stateCell.state.v2 ? se_idx : sw_idx };
-    unsigned int inactive_node_idx { stateCell.state.v2 ? sw_idx : se_idx };
+                for (unsigned int e = 0; e < edge_case.count; ++e)
+                {
+                    const unsigned int id { static_cast<unsigned int>(points.size()) };
+                    switch (edge_case.edges[e])
+                    {
+                        case Top:
+                            if (y_i > y_begin) { indices.push_back(above[x_i]); }
+                            else if (seam_above) { indices.push_back(seam_flag | x_i); }
+                            else
+                            {
+                                points.push_back(edgePoint<Interp>(Top, index, x_i, y_i, top, bottom));
+                                indices.push_back(id);
+                            }
+                            break;
+
+                        case Left:
+                            if (x_i > 0) { indices.push_back(left_edge); }
+                            else
+                            {
+                                points.push_back(edgePoint<Interp>(Left, index, x_i, y_i, top, bottom));
+                                indices.push_back(id);
+                            }
+                            break;
+
+                        case Right:
+                            points.push_back(edgePoint<Interp>(Right, index, x_i, y_i, top, bottom));
+                            left_edge = id;
+                            indices.push_back(id);
+                            break;
+
+                        case Bottom:
+                            points.push_back(edgePoint<Interp>(Bottom, index, x_i, y_i, top, bottom));
+                            below[x_i] = id;
+                            indices.push_back(id);
+                            break;
+                    }
+                }
 
-    pushX(active_node_idx, inactive_node_idx);
+                if (links)
+                {
+                    links->resize(points.size(), { no_link, no_link });
+                    for (std::size_t i = first_index; i < indices.size(); i += 2)
+                    {
+                        link(*links, indices[i], indices[i + 1]);
+                    }
+                }
+            });
+        }
+
+        // this row's bottom crossings are the next row's top crossings
+        std::swap(above, below);
+    }
 }
 
-void MarchingSquares::right(const StateCell& stateCell)
+template <typename T>
+void BasicMarchingSquares<T>::marchParallel(const unsigned int stride, const unsigned int threads)
 {
-    unsigned int ne_idx { stateCell.cell.ne };
-    unsigned int se_idx { stateCell.cell.se };
+    // split the cell rows into contiguous bands; a few bands per thread balances
+    // uneven contour density, and concatenating them in band order reproduces the
+    // serial vertex order exactly
+    const unsigned int rows { m_grid.rows() - 1 };
+    const unsigned int band_count { std::min(rows, 4 * threads) };
+    if (m_bands.size() < band_count) { m_bands.resize(band_count); }
+
+    #pragma omp parallel for schedule(dynamic) num_threads(threads)
+    for (unsigned int b = 0; b < band_count; ++b)
+    {
+        Band& band { m_bands[b] };
+        band.points.clear();
+        band.indices.clear();
+
+        const unsigned int y_begin { rows * b / band_count };
+        const unsigned int y_end { rows * (b + 1) / band_count };
+        if (m_indexed || m_polylines)
+        {
+            marchRowsIndexed(stride, y_begin, y_end, b > 0, band.points, band.indices, band.above, band.below);
+        }
+        else
+        {
+            marchActiveRows(stride, y_begin, y_end, band.points);
+        }
+    }
 
-    unsigned int active_node_idx { stateCell.state.v1 ? ne_idx : se_idx };
-    unsigned int inactive_node_idx { stateCell.state.v1 ? se_idx : ne_idx };
+    // stitch
+    std::vector<std::size_t>& offsets { m_band_offsets };
+    std::vector<std::size_t>& index_offsets { m_band_index_offsets };
+    offsets.assign(band_count + 1, 0);
+    index_offsets.assign(band_count + 1, 0);
+    for (unsigned int b = 0; b < band_count; ++b)
+    {
+        offsets[b + 1] = offsets[b] + m_bands[b].points.size();
+        index_offsets[b + 1] = index_offsets[b] + m_bands[b].indices.size();
+    }
+    m_points.resize(offsets[band_count]);
+    m_indices.resize(index_offsets[band_count]);
+
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (unsigned int b = 0; b < band_count; ++b)
+    {
+        const Band& band { m_bands[b] };
+        std::copy(band.points.begin(), band.points.end(), m_points.begin() + static_cast<std::ptrdiff_t>(offsets[b]));
+
+        // local vertex ids to global ones; seam references resolve to the previous
+        // band's crossings below its last row (left in `above` by the final swap)
+        unsigned int* out { m_indices.data() + index_offsets[b] };
+        const unsigned int offset { static_cast<unsigned int>(offsets[b]) };
+        for (const unsigned int id : band.indices)
+        {
+            *out++ = (id & seam_flag)
+                ? m_bands[b - 1].above[id & ~seam_flag] + static_cast<unsigned int>(offsets[b - 1])
+                : id + offset;
+        }
+    }
 
-    pushY(active_node_idx, inactive_node_idx);
+    // bands only know their own vertices, so link the stitched segments
+    if (m_polylines)
+    {
+        m_links.assign(m_points.size(), { no_link, no_link });
+        for (std::size_t i = 0; i < m_indices.size(); i += 2)
+        {
+            link(m_links, m_indices[i], m_indices[i + 1]);
+        }
+    }
 }
 
-void MarchingSquares::left(const StateCell& stateCell)
+template <typename T>
+void BasicMarchingSquares<T>::marchIncremental(const BasicGrid<T>& grid, const unsigned int threads)
 {
-    unsigned int nw_idx { stateCell.cell.nw };
-    unsigned int sw_idx { stateCell.cell.sw };
+    const unsigned int tile_count { grid.tilesX() * grid.tilesY() };
+
+    // a new isolevel or interpolation mode changes every tile
+    const bool all_stale { m_tiles.size() != tile_count || m_tiles_isolevel != m_isolevel || m_tiles_interp != m_interp || m_tiles_saddle != m_saddle };
+    m_tiles.resize(tile_count);
+    m_tiles_isolevel = m_isolevel;
+    m_tiles_interp = m_interp;
+    m_tiles_saddle = m_saddle;
+
+    m_stale_tiles.clear();
+    for (unsigned int t = 0; t < tile_count; ++t)
+    {
+        if (all_stale || m_tiles[t].version != grid.tileVersion(t)) { m_stale_tiles.push_back(t); }
+    }
+
+    #pragma omp parallel for schedule(dynamic) num_threads(threads)
+    for (std::size_t i = 0; i < m_stale_tiles.size(); ++i)
+    {
+        const unsigned int t { m_stale_tiles[i] };
+        const unsigned int x_begin { (t % grid.tilesX()) * BasicGrid<T>::tile_size };
+        const unsigned int y_begin { (t / grid.tilesX()) * BasicGrid<T>::tile_size };
+
+        Tile& tile { m_tiles[t] };
+        tile.points.clear();
+        tile.version = grid.tileVersion(t);
+        if (!std::binary_search(m_active_tiles.begin(), m_active_tiles.end(), t)) { continue; }
+
+        marchRows(grid.stride(),
+                  x_begin, std::min(x_begin + BasicGrid<T>::tile_size, grid.resolution() - 1),
+                  y_begin, std::min(y_begin + BasicGrid<T>::tile_size, grid.rows() - 1),
+                  tile.points);
+    }
 
-    unsigned int active_node_idx { stateCell.state.v0 ? nw_idx : sw_idx };
-    unsigned int inactive_node_idx { stateCell.state.v0 ? sw_idx : nw_idx };
+    // concatenate the cached tiles
+    std::size_t total { 0 };
+    for (const Tile& tile : m_tiles) { total += tile.points.size(); }
+    m_points.reserve(total);
+    for (const Tile& tile : m_tiles)
+    {
+        m_points.insert(m_points.end(), tile.points.begin(), tile.points.end());
+    }
+}
 
-    pushY(active_node_idx, inactive_node_idx);
+template <typename T>
+void BasicMarchingSquares<T>::findActiveRuns(const BasicGrid<T>& grid)
+{
+    // a tile whose values all lie on one side of the isolevel holds no contour
+    grid.activeTiles(m_isolevel, m_active_tiles);
+
+    // merge neighbouring active tiles of a tile row into one run of cell columns
+    const unsigned int cells { grid.resolution() - 1 };
+    m_runs.clear();
+    m_run_offsets.assign(grid.tilesY() + 1, 0);
+    for (std::size_t i = 0; i < m_active_tiles.size(); ++i)
+    {
+        const unsigned int t { m_active_tiles[i] };
+        const unsigned int x_begin { (t % grid.tilesX()) * BasicGrid<T>::tile_size };
+        const unsigned int x_end { std::min(x_begin + BasicGrid<T>::tile_size, cells) };
+        const bool continues { i > 0 && m_active_tiles[i - 1] + 1 == t && x_begin > 0 };
+        if (continues) { m_runs.back()[1] = x_end; }
+        else { m_runs.push_back({ x_begin, x_end }); }
+        m_run_offsets[t / grid.tilesX() + 1] = static_cast<unsigned int>(m_runs.size());
+    }
+    // rows without active tiles end where the previous row did
+    for (unsigned int ty = 1; ty <= grid.tilesY(); ++ty)
+    {
+        m_run_offsets[ty] = std::max(m_run_offsets[ty], m_run_offsets[ty - 1]);
+    }
 }
 
-void MarchingSquares::addEdgeVertices(State& state, const Cell& cell)
+template <typename T>
+void BasicMarchingSquares<T>::buildPolylines()
 {
-    StateCell sc { state, cell };
-    switch (state.state())
+    // order the linked vertices: open chains start at a vertex with a single
+    // neighbour (on the grid boundary), everything left over is a closed loop
+    const unsigned int vertex_count { static_cast<unsigned int>(m_points.size()) };
+    m_links.resize(vertex_count, { no_link, no_link });
+    m_visited.assign(vertex_count, 0);
+
+    auto walk = [&](const unsigned int start, const bool closed)
     {
-        case 1:
-            left(sc);
-            bottom(sc);
-            return;
-        
-        case 2:
-            right(sc);
-            bottom(sc);
-            return;
+        Polyline polyline { static_cast<unsigned int>(m_polyline_vertices.size()), 0, closed };
+        unsigned int prev { no_link };
+        unsigned int cur { start };
+        while (cur != no_link && !m_visited[cur])
+        {
+            m_visited[cur] = 1;
+            m_polyline_vertices.push_back(cur);
+            const unsigned int next { m_links[cur][0] != prev ? m_links[cur][0] : m_links[cur][1] };
+            prev = cur;
+            cur = next;
+        }
+        polyline.count = static_cast<unsigned int>(m_polyline_vertices.size()) - polyline.first;
+        m_polyline_list.push_back(polyline);
+    };
 
-        case 3:
-            left(sc);
-            right(sc);
-            return;
+    for (unsigned int v = 0; v < vertex_count; ++v)
+    {
+        if (!m_visited[v] && (m_links[v][1] == no_link)) { walk(v, false); }
+    }
+    for (unsigned int v = 0; v < vertex_count; ++v)
+    {
+        if (!m_visited[v]) { walk(v, true); }
+    }
+}
 
-        case 4:
-            top(sc);
-            right(sc);
-            return;
+template <typename T>
+std::vector<float> BasicMarchingSquares<T>::positions()
+{
+    std::vector<float> positions;
+    this->positions(positions);
+    return positions;
+}
 
-        case 5:
-            left(sc);
-            top(sc);
+template <typename T>
+std::size_t BasicMarchingSquares<T>::writePositions(const std::span<float> out) const
+{
+    const std::size_t count { positionCount() };
+    if (out.size() < count) { return count; }
+    PROFILE_ZONE("MarchingSquares::positions");
 
-            bottom(sc);
-            right(sc);
-            return;
+    float* dst { out.data() };
+    for (const Point& point : m_points)
+    {
+        const glm::vec2& pos { point.position() };
 
-        case 6:
-            top(sc);
-            bottom(sc);
-            return;
+        *dst++ = pos.x;
+        *dst++ = pos.y;
+    }
 
-        case 7:
-            left(sc);
-            top(sc);
-            return;
+    return count;
+}
 
-        case 8:
-            top(sc);
-            left(sc);
-            return;
+template <typename T>
+void BasicMarchingSquares<T>::positions(std::vector<float>& out) const
+{
+    out.resize(positionCount());
+    writePositions(out);
+}
 
-        case 9:
-            top(sc);
-            bottom(sc);
-            return;
+template <typename T>
+unsigned int BasicMarchingSquares<T>::active(const T value) const
+{
+    return (ScalarTraits<T>::compute(value) < m_isolevel) ? 0 : 1;
+}
 
-        case 10:
-            left(sc);
-            bottom(sc);
+template <typename T>
+void BasicMarchingSquares<T>::classify(const T* values, const unsigned int count, std::uint64_t* masks) const
+{
+    if constexpr (std::is_same_v<T, float>)
+    {
+        selectClassifyRowKernel()(values, count, m_isolevel, masks);
+    }
+    else
+    {
+        std::fill(masks, masks + (count + 63) / 64, std::uint64_t { 0 });
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            masks[i / 64] |= static_cast<std::uint64_t>(active(values[i])) << (i % 64);
+        }
+    }
+}
 
-            top(sc);
-            right(sc);
-            return;
+template <typename T>
+template <typename Visit>
+void BasicMarchingSquares<T>::forEachCrossedCell(const T* top, const T* bottom, const unsigned int x_begin, const unsigned int x_end, Visit&& visit) const
+{
+    std::uint64_t top_masks[chunk_words];
+    std::uint64_t bottom_masks[chunk_words];
+    PROFILE_COUNT(Counter::CellsScanned, x_end > x_begin ? x_end - x_begin : 0);
 
-        case 11:
-            top(sc);
-            right(sc);
-            return;
+    for (unsigned int chunk = x_begin; chunk < x_end; chunk += chunk_cells)
+    {
+        // one node more than cells: the last cell's right corners
+        const unsigned int cells { std::min(chunk_cells, x_end - chunk) };
+        const unsigned int node_words { cells / 64 + 1 };
+        classify(top + chunk, cells + 1, top_masks);
+        classify(bottom + chunk, cells + 1, bottom_masks);
 
-        case 12:
-            left(sc);
-            right(sc);
-            return;
+        for (unsigned int w = 0; w * 64 < cells; ++w)
+        {
+            // bit i of each mask is one corner of cell chunk + w * 64 + i; the right
+            // corners are the left ones shifted down, carrying in the next word
+            const std::uint64_t nw { top_masks[w] };
+            const std::uint64_t sw { bottom_masks[w] };
+            const std::uint64_t ne { nw >> 1 | (w + 1 < node_words ? top_masks[w + 1] << 63 : 0) };
+            const std::uint64_t se { sw >> 1 | (w + 1 < node_words ? bottom_masks[w + 1] << 63 : 0) };
+
+            // a cell is uniform unless its top, left or right edge is crossed (the bottom then follows)
+            std::uint64_t crossed { (nw ^ ne) | (nw ^ sw) | (ne ^ se) };
+            if (cells - w * 64 < 64) { crossed &= (std::uint64_t { 1 } << (cells - w * 64)) - 1; }
+            PROFILE_COUNT(Counter::ActiveCells, std::popcount(crossed));
+
+            while (crossed)
+            {
+                const unsigned int bit { static_cast<unsigned int>(std::countr_zero(crossed)) };
+                const unsigned int index { static_cast<unsigned int>((nw >> bit & 1) << 3 | (ne >> bit & 1) << 2 | (se >> bit & 1) << 1 | (sw >> bit & 1)) };
+                visit(chunk + w * 64 + bit, index);
+                crossed &= crossed - 1;
+            }
+        }
+    }
+}
 
-        case 13:
-            right(sc);
-            bottom(sc);
-            return;
+template <typename T>
+const char* BasicMarchingSquares<T>::classifyKernelName()
+{
+    return classifyRowKernelName();
+}
 
-        case 14:
-            left(sc);
-            bottom(sc);
-            return;
+template <typename T>
+template <SaddlePolicy Saddle>
+unsigned int BasicMarchingSquares<T>::emittedCase(const unsigned int index, const unsigned int x_i, const T* top, const T* bottom) const
+{
+    if constexpr (Saddle == SaddlePolicy::Average)
+    {
+        if (index == 5 || index == 10)
+        {
+            const compute_type sum {
+                ScalarTraits<T>::compute(top[x_i]) + ScalarTraits<T>::compute(top[x_i + 1])
+                + ScalarTraits<T>::compute(bottom[x_i + 1]) + ScalarTraits<T>::compute(bottom[x_i])
+            };
+            // an inactive centre separates the active corners
+            if (sum / 4 < m_isolevel) { return index ^ 15; }
+        }
     }
+    return index;
 }
 
-void MarchingSquares::clear()
+template <typename T>
+template <bool Interp>
+Point BasicMarchingSquares<T>::edgePoint(const Edge edge, const unsigned int index, const unsigned int x_i, const unsigned int y_i,
+                                         const T* top, const T* bottom) const
+{
+    const Corner& a { edge_corners[edge][0] };
+    const Corner& b { edge_corners[edge][1] };
+    const Corner& on { (index & a.bit) ? a : b };
+    const Corner& off { (index & a.bit) ? b : a };
+
+    const float on_x { m_grid.x(x_i + on.dx) };
+    const float on_y { m_grid.y(y_i + on.dy) };
+    const bool horizontal { edge == Top || edge == Bottom };
+    const float off_pos { horizontal ? m_grid.x(x_i + off.dx) : m_grid.y(y_i + off.dy) };
+    const compute_type on_value { ScalarTraits<T>::compute((on.dy ? bottom : top)[x_i + on.dx]) };
+    const compute_type off_value { ScalarTraits<T>::compute((off.dy ? bottom : top)[x_i + off.dx]) };
+
+    const float pos { edgeCrossing(horizontal ? on_x : on_y, off_pos, on_value, off_value, m_isolevel, Interp) };
+    return horizontal ? Point(pos, on_y) : Point(on_x, pos);
+}
+
+template <typename T>
+void BasicMarchingSquares<T>::clear()
 {
     m_points.clear();
+    m_indices.clear();
+    m_links.clear();
+    m_polyline_list.clear();
+    m_polyline_vertices.clear();
 }
+
+template class BasicMarchingSquares<float>;
+template class BasicMarchingSquares<double>;
+template class BasicMarchingSquares<Half>;
+template class BasicMarchingSquares<std::uint16_t>;
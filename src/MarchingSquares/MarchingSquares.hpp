@@ -1,62 +1,274 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include <vector>
 #include "../Point/Point.hpp"
 #include "../Grid/Grid.hpp"
+#include "../BufferStats/BufferStats.hpp"
 
 struct State
 {
     bool v0, v1, v2, v3;
 
-    bool hasEdge() { return !((v0 && v1 && v2 && v3) || !(v0 || v1 || v2 || v3)); }
+    bool hasEdge() const { return !((v0 && v1 && v2 && v3) || !(v0 || v1 || v2 || v3)); }
 
-    unsigned int state()
+    unsigned int state() const
     {
         return 8 * v0 + 4 * v1 + 2 * v2 + v3;
     }
 };
 
-struct Cell
+enum Edge : unsigned char { Top, Right, Bottom, Left };
+
+// corner bits of a case index (State::state())
+struct Corner
+{
+    unsigned char bit, dx, dy;
+};
+
+inline constexpr Corner nw_corner { 8, 0, 0 };
+inline constexpr Corner ne_corner { 4, 1, 0 };
+inline constexpr Corner se_corner { 2, 1, 1 };
+inline constexpr Corner sw_corner { 1, 0, 1 };
+
+// the two corners each edge joins; the crossing is measured from whichever of them is active
+inline constexpr Corner edge_corners[4][2] = {
+    { nw_corner, ne_corner }, // Top
+    { ne_corner, se_corner }, // Right
+    { se_corner, sw_corner }, // Bottom
+    { nw_corner, sw_corner }  // Left
+};
+
+// how the two ambiguous cases (5 and 10, diagonal corners active) are split
+enum class SaddlePolicy
+{
+    Active, // always join the active corners through the cell centre
+    Average // join the active corners if the mean of all four is active, the inactive ones otherwise
+};
+
+// edges crossed by each case, in emission order (pairs form segments); case 15 - i
+// crosses the same edges as case i, so saddles are flipped by indexing with i ^ 15
+struct EdgeCase
 {
-    unsigned int nw, ne, se, sw;
+    unsigned char count;
+    Edge edges[4];
+};
+
+inline constexpr EdgeCase edge_cases[16] = {
+    { 0, {} },
+    { 2, { Left, Bottom } },
+    { 2, { Right, Bottom } },
+    { 2, { Left, Right } },
+    { 2, { Top, Right } },
+    { 4, { Left, Top, Bottom, Right } },
+    { 2, { Top, Bottom } },
+    { 2, { Left, Top } },
+    { 2, { Top, Left } },
+    { 2, { Top, Bottom } },
+    { 4, { Left, Bottom, Top, Right } },
+    { 2, { Top, Right } },
+    { 2, { Left, Right } },
+    { 2, { Right, Bottom } },
+    { 2, { Left, Bottom } },
+    { 0, {} }
 };
 
-struct StateCell
+// where the contour crosses the edge from an active node (value >= isolevel) to an inactive one,
+// given their positions (along the edge, or as glm::vec2 or glm::vec3): interpolated linearly, or
+// the midpoint. Every marcher measures from the active end, so the cells on either side of an
+// edge compute the same crossing to the bit
+template <typename Position, typename Value>
+inline Position edgeCrossing(const Position& active_pos, const Position& inactive_pos, const Value active, const Value inactive,
+                             const Value isolevel, const bool interp)
 {
-    State state;
-    Cell cell;
+    if (!interp) { return (active_pos + inactive_pos) / 2.0f; }
+    const float t { static_cast<float>(1 - (isolevel - inactive) / (active - inactive)) };
+    return active_pos + t * (inactive_pos - active_pos);
+}
+
+struct Polyline
+{
+    unsigned int first; // offset into MarchingSquares::polylineVertices()
+    unsigned int count;
+    bool closed;        // the last vertex connects back to the first
 };
 
-class MarchingSquares
+// Isolines of a BasicGrid<T>; values are compared and interpolated as
+// ScalarTraits<T>::compute_type straight from the grid's storage.
+template <typename T>
+class BasicMarchingSquares
 {
 private:
-    float m_isolevel;
+    using compute_type = typename ScalarTraits<T>::compute_type;
+
+    compute_type m_isolevel;
     bool m_interp;
+    SaddlePolicy m_saddle { SaddlePolicy::Active };
+    unsigned int m_threads { 1 };
+    bool m_indexed { false };
+    bool m_polylines { false };
     std::vector<Point> m_points;
+    std::vector<unsigned int> m_indices;
+
+    // polyline mode: the (at most two) segment neighbours of every vertex, recorded as segments are emitted
+    std::vector<std::array<unsigned int, 2>> m_links;
+    std::vector<Polyline> m_polyline_list;
+    std::vector<unsigned int> m_polyline_vertices;
+    std::vector<unsigned char> m_visited;
 
-    const std::vector<Point>& m_grid_points;
-    const std::vector<float>& m_grid_values;
-    State m_state;
+    struct Band
+    {
+        std::vector<Point> points;
+        std::vector<unsigned int> indices;
+        // indexed mode: vertex ids of the crossings on the horizontal edges above and below the current cell row
+        std::vector<unsigned int> above, below;
+    };
+
+    // per-band output buffers for the parallel march, kept to reuse their capacity
+    std::vector<Band> m_bands;
+    // where each band's points and indices start in the stitched output
+    std::vector<std::size_t> m_band_offsets, m_band_index_offsets;
+
+    // incremental mode: segments of every Grid tile, with the tile version they were marched at
+    struct Tile
+    {
+        std::vector<Point> points;
+        std::uint64_t version;
+    };
+    bool m_incremental { false };
+    std::vector<Tile> m_tiles;
+    std::vector<unsigned int> m_stale_tiles;
+    compute_type m_tiles_isolevel { 0 };
+    bool m_tiles_interp { false };
+    SaddlePolicy m_tiles_saddle { SaddlePolicy::Active };
+
+    // cells worth scanning: for every tile row, runs [begin, end) of cell columns
+    // over consecutive tiles whose value range straddles the isolevel
+    std::vector<unsigned int> m_active_tiles;
+    std::vector<std::array<unsigned int, 2>> m_runs;
+    std::vector<unsigned int> m_run_offsets;
+
+    // edge caches for the serial indexed march
+    std::vector<unsigned int> m_above, m_below;
+
+    // every buffer above is cleared, never freed, between marches
+    BufferTracker m_buffers;
+    void trackBuffers();
+
+    // node positions are computed from the grid spacing, never read from storage
+    const BasicGrid<T>& m_grid;
+    const T* m_grid_values;
 
-    float lerp(const float a, const float b, const float t);
-    void pushX(unsigned int active_node_idx, unsigned int inactive_node_idx);
-    void pushY(unsigned int active_node_idx, unsigned int inactive_node_idx);
+    unsigned int active(const T value) const;
 
-    bool active(const float value);
+    // the cell scan classifies node rows in chunks of this many cells (plus one node) at a time
+    static constexpr unsigned int chunk_cells { 256 };
+    static constexpr unsigned int chunk_words { chunk_cells / 64 + 1 };
+    // packs active() of `count` values into bitmasks, as classifyRowScalar
+    void classify(const T* values, const unsigned int count, std::uint64_t* masks) const;
+    // calls visit(x_i, case index) for every cell in [x_begin, x_end) of the cell row between the
+    // `top` and `bottom` node rows that has a crossing, in increasing x; uniform cells are skipped
+    // whole words at a time
+    template <typename Visit>
+    void forEachCrossedCell(const T* top, const T* bottom, const unsigned int x_begin, const unsigned int x_end, Visit&& visit) const;
 
-    void top(const StateCell& stateCell);
-    void bottom(const StateCell& stateCell);
-    void right(const StateCell& stateCell);
-    void left(const StateCell& stateCell);
-    void addEdgeVertices(State& state, const Cell& cell);
+    // case index of cell x_i between the node rows `top` and `bottom`, with saddles flipped as the policy asks
+    template <SaddlePolicy Saddle>
+    unsigned int emittedCase(const unsigned int index, const unsigned int x_i, const T* top, const T* bottom) const;
+    // crossing on `edge` of the cell whose nw node is (x_i, y_i), for case `index`; `top` and
+    // `bottom` are the node rows y_i and y_i + 1
+    template <bool Interp>
+    Point edgePoint(const Edge edge, const unsigned int index, const unsigned int x_i, const unsigned int y_i,
+                    const T* top, const T* bottom) const;
+
+    // marches cells [x_begin, x_end) x [y_begin, y_end) in row major order; node values are `stride` apart per row
+    void marchRows(const unsigned int stride, const unsigned int x_begin, const unsigned int x_end,
+                   const unsigned int y_begin, const unsigned int y_end, std::vector<Point>& points) const;
+    template <bool Interp, SaddlePolicy Saddle>
+    void marchRowsKernel(const unsigned int stride, const unsigned int x_begin, const unsigned int x_end,
+                         const unsigned int y_begin, const unsigned int y_end, std::vector<Point>& points) const;
+    // cells [x_begin, x_end) of cell row y_i, between the node rows `top` and `bottom`
+    template <bool Interp, SaddlePolicy Saddle>
+    void marchRowKernel(const T* top, const T* bottom, const unsigned int y_i, const unsigned int x_begin, const unsigned int x_end,
+                        std::vector<Point>& points) const;
+    // marches the active runs of rows [y_begin, y_end), still in row major order
+    void marchActiveRows(const unsigned int stride, const unsigned int y_begin, const unsigned int y_end, std::vector<Point>& points) const;
+    // same scan, but every edge crossing becomes one vertex referenced by index from both cells sharing it;
+    // with seam_above the crossings above the first row belong to the band before and are emitted as seam references
+    void marchRowsIndexed(const unsigned int stride, const unsigned int y_begin, const unsigned int y_end, const bool seam_above,
+                          std::vector<Point>& points, std::vector<unsigned int>& indices,
+                          std::vector<unsigned int>& above, std::vector<unsigned int>& below,
+                          std::vector<std::array<unsigned int, 2>>* links = nullptr) const;
+    template <bool Interp, SaddlePolicy Saddle>
+    void marchRowsIndexedKernel(const unsigned int stride, const unsigned int y_begin, const unsigned int y_end, const bool seam_above,
+                                std::vector<Point>& points, std::vector<unsigned int>& indices,
+                                std::vector<unsigned int>& above, std::vector<unsigned int>& below,
+                                std::vector<std::array<unsigned int, 2>>* links) const;
+    void findActiveRuns(const BasicGrid<T>& grid);
+    void buildPolylines();
+    void marchIncremental(const BasicGrid<T>& grid, const unsigned int threads);
+    void marchParallel(const unsigned int stride, const unsigned int threads);
 
 public:
-    MarchingSquares(const float isolevel, const bool interp, const Grid& grid);
+    BasicMarchingSquares(const compute_type isolevel, const bool interp, const BasicGrid<T>& grid);
 
-    void march(const Grid& grid);
+    void march(const BasicGrid<T>& grid);
+    // marches the one row of cells between the node rows `top` and `bottom` (resolution() values
+    // each), placed as rows y_i and y_i + 1 of the grid's lattice, and appends its segments to
+    // `points` as march() would emit them; for callers that only hold a window of rows
+    void marchRow(const T* top, const T* bottom, const unsigned int y_i, std::vector<Point>& points) const;
+    // segment endpoint pairs, or the unique vertices when indexed
     std::vector<Point>& points() { return m_points; }
+    // indexed mode: vertex index pairs, one per segment (GL_LINES)
+    const std::vector<unsigned int>& indices() const { return m_indices; }
     std::vector<float> positions();
-    float getIsolevel() { return m_isolevel; }
-    void setIsolevel(const float isolevel) { m_isolevel = isolevel; }
+    // floats positions() holds: x, y per point
+    std::size_t positionCount() const { return 2 * m_points.size(); }
+    // writes positions() straight into `out` (e.g. a mapped vertex buffer) and returns
+    // positionCount(); writes nothing if `out` is smaller than that, so the caller can grow and retry
+    std::size_t writePositions(std::span<float> out) const;
+    // same, into `out` resized to fit; its capacity only ever grows, so a reused vector stops allocating
+    void positions(std::vector<float>& out) const;
+    compute_type getIsolevel() const { return m_isolevel; }
+    void setIsolevel(const compute_type isolevel) { m_isolevel = isolevel; }
+    SaddlePolicy saddlePolicy() const { return m_saddle; }
+    void setSaddlePolicy(const SaddlePolicy saddle) { m_saddle = saddle; }
+    // name of the row classification kernel picked for this CPU ("avx", "sse2" or "scalar"; float grids only)
+    static const char* classifyKernelName();
+
+    // 1 marches serially, 0 uses every available core; output order is the same either way
+    unsigned int threads() const { return m_threads; }
+    void setThreads(const unsigned int threads) { m_threads = threads; }
+
+    // incremental mode: only re-march the Grid tiles whose values changed since the
+    // last march (see BasicGrid::markDirty) and reuse the cached segments of all others.
+    // points() is then ordered tile by tile; ignored for indexed/polyline output
+    bool incremental() const { return m_incremental; }
+    void setIncremental(const bool incremental) { m_incremental = incremental; }
+    // tiles re-marched by the last incremental march
+    unsigned int staleTiles() const { return static_cast<unsigned int>(m_stale_tiles.size()); }
+
+    // capacity held by the output and scratch buffers after the last march, and how often they grew;
+    // once warmed up to the largest contour a march allocates nothing
+    const BufferStats& bufferStats() const { return m_buffers.stats(); }
+
+    // tiles that straddled the isolevel in the last march; all others were skipped (see BasicGrid::activeTiles)
+    unsigned int activeTiles() const { return static_cast<unsigned int>(m_active_tiles.size()); }
+
+    // indexed output: each edge crossing is computed once and shared by the two cells on either side
+    bool indexed() const { return m_indexed || m_polylines; }
+    void setIndexed(const bool indexed) { m_indexed = indexed; }
+
+    // connected polylines, built during the scan; implies indexed output
+    bool polylines() const { return m_polylines; }
+    void setPolylines(const bool polylines) { m_polylines = polylines; }
+    const std::vector<Polyline>& polylineList() const { return m_polyline_list; }
+    // indices into points(), each polyline's vertices in order
+    const std::vector<unsigned int>& polylineVertices() const { return m_polyline_vertices; }
     void clear();
 };
+
+using MarchingSquares = BasicMarchingSquares<float>;
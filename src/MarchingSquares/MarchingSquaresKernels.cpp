@@ -0,0 +1,105 @@
+#include "MarchingSquaresKernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    // the values from `begin` on, into masks[begin / 64] onwards; `begin` is a multiple of 64
+    void classifyTail(const float* values, const unsigned int begin, const unsigned int count, const float isolevel, std::uint64_t* masks)
+    {
+        for (unsigned int w = begin; w < count; w += 64)
+        {
+            std::uint64_t mask { 0 };
+            for (unsigned int i = w; i < count && i < w + 64; ++i)
+            {
+                mask |= static_cast<std::uint64_t>(!(values[i] < isolevel)) << (i - w);
+            }
+            masks[w / 64] = mask;
+        }
+    }
+
+    struct Selected
+    {
+        ClassifyRowKernel kernel;
+        const char* name;
+    };
+
+    Selected select()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx")) { return { classifyRowAVX, "avx" }; }
+        if (__builtin_cpu_supports("sse2")) { return { classifyRowSSE2, "sse2" }; }
+#endif
+        return { classifyRowScalar, "scalar" };
+    }
+
+    const Selected& selected()
+    {
+        static const Selected s { select() };
+        return s;
+    }
+}
+
+void classifyRowScalar(const float* values, const unsigned int count, const float isolevel, std::uint64_t* masks)
+{
+    classifyTail(values, 0, count, isolevel, masks);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// "not less than" rather than "greater or equal", so NaN counts as active like MarchingSquares::active
+
+__attribute__((target("sse2")))
+void classifyRowSSE2(const float* values, const unsigned int count, const float isolevel, std::uint64_t* masks)
+{
+    const __m128 iso { _mm_set1_ps(isolevel) };
+
+    unsigned int w { 0 };
+    for (; w + 64 <= count; w += 64)
+    {
+        std::uint64_t mask { 0 };
+        for (unsigned int j = 0; j < 64; j += 4)
+        {
+            const int bits { _mm_movemask_ps(_mm_cmpnlt_ps(_mm_loadu_ps(values + w + j), iso)) };
+            mask |= static_cast<std::uint64_t>(static_cast<unsigned int>(bits)) << j;
+        }
+        masks[w / 64] = mask;
+    }
+
+    classifyTail(values, w, count, isolevel, masks);
+}
+
+__attribute__((target("avx")))
+void classifyRowAVX(const float* values, const unsigned int count, const float isolevel, std::uint64_t* masks)
+{
+    const __m256 iso { _mm256_set1_ps(isolevel) };
+
+    unsigned int w { 0 };
+    for (; w + 64 <= count; w += 64)
+    {
+        std::uint64_t mask { 0 };
+        for (unsigned int j = 0; j < 64; j += 8)
+        {
+            const int bits { _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(values + w + j), iso, _CMP_NLT_UQ)) };
+            mask |= static_cast<std::uint64_t>(static_cast<unsigned int>(bits)) << j;
+        }
+        masks[w / 64] = mask;
+    }
+
+    classifyTail(values, w, count, isolevel, masks);
+}
+
+#endif
+
+ClassifyRowKernel selectClassifyRowKernel()
+{
+    return selected().kernel;
+}
+
+const char* classifyRowKernelName()
+{
+    return selected().name;
+}
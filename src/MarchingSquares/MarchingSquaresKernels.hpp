@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+// Row classification behind MarchingSquares' cell scan.
+//
+// A row of node values is compared against the isolevel a vector at a time and
+// packed into bitmasks: bit i % 64 of masks[i / 64] is set when node i is
+// active (not below the isolevel). Bits past `count` in the last word are
+// cleared, so whole words can be combined without masking.
+using ClassifyRowKernel = void (*)(const float* values, const unsigned int count, const float isolevel, std::uint64_t* masks);
+
+void classifyRowScalar(const float* values, const unsigned int count, const float isolevel, std::uint64_t* masks);
+
+#if defined(__x86_64__) || defined(__i386__)
+void classifyRowSSE2(const float* values, const unsigned int count, const float isolevel, std::uint64_t* masks);
+void classifyRowAVX(const float* values, const unsigned int count, const float isolevel, std::uint64_t* masks);
+#endif
+
+// picks the widest kernel the running CPU supports (once)
+ClassifyRowKernel selectClassifyRowKernel();
+const char* classifyRowKernelName();
@@ -1,5 +1,24 @@
 #include "Particle.hpp"
 
+#include <algorithm>
+#include <utility>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+    // -v if the particle overlaps the wall at `lo` or `hi` and is still heading into it, v otherwise;
+    // particles already turned around are left alone, so they cannot stick to a wall
+    float reflect(const float position, const float radius, const float velocity, const float lo, const float hi)
+    {
+        // bitwise, so the test stays branch free inside the vectorized loop
+        const bool outward { (((position - radius < lo) & (velocity < 0.0f)) | ((position + radius > hi) & (velocity > 0.0f))) != 0 };
+        return outward ? -velocity : velocity;
+    }
+}
+
 void Particle::updatePosition(const float dt)
 {
     m_position += m_velocity * dt;
@@ -7,19 +26,146 @@ void Particle::updatePosition(const float dt)
 
 void Particle::applyBoundaryCondition(const float width, const float height)
 {
-    // assumes domain is [0, width] x [0, height]
-    if ( (m_position.x - m_radius < 0.0f) || (m_position.x + m_radius > width) )
+    // assumes domain is [0, width] x [0, height]; a corner reflects both components
+    m_velocity.x = reflect(m_position.x, m_radius, m_velocity.x, 0.0f, width);
+    m_velocity.y = reflect(m_position.y, m_radius, m_velocity.y, 0.0f, height);
+}
+
+void Particle::evolve(const float width, const float height, const float dt)
+{
+    applyBoundaryCondition(width, height);
+    updatePosition(dt);
+}
+
+Particles::Particles(const std::vector<Particle>& particles)
+    : m_positions {}
+    , m_velocities {}
+    , m_radii {}
+    , m_hash {}
+    , m_next_velocities {}
+{
+    reserve(particles.size());
+    for (const Particle& particle : particles)
     {
-        m_velocity.x *= -1.0f;
+        add(particle.radius(), particle.position(), particle.velocity());
     }
-    else if ( (m_position.y - m_radius < 0.0f) || (m_position.y + m_radius > height) )
+}
+
+void Particles::add(const float radius, const glm::vec2& position, const glm::vec2& velocity)
+{
+    m_hash_current = false;
+    m_positions.push_back(position);
+    m_velocities.push_back(velocity);
+    m_radii.push_back(radius);
+}
+
+void Particles::reserve(const std::size_t count)
+{
+    m_positions.reserve(count);
+    m_velocities.reserve(count);
+    m_radii.reserve(count);
+}
+
+void Particles::clear()
+{
+    m_hash_current = false;
+    m_positions.clear();
+    m_velocities.clear();
+    m_radii.clear();
+}
+
+void Particles::evolve(const float width, const float height, const float dt)
+{
+#ifdef _OPENMP
+    const int threads { m_threads == 0 ? omp_get_max_threads() : static_cast<int>(m_threads) };
+#endif
+
+    // every particle is independent: split across threads, and within a thread the
+    // branch free body vectorizes over consecutive particles
+    const long count { static_cast<long>(size()) };
+    glm::vec2* positions { m_positions.data() };
+    glm::vec2* velocities { m_velocities.data() };
+    const float* radii { m_radii.data() };
+
+    #pragma omp parallel for simd schedule(static) num_threads(threads)
+    for (long i = 0; i < count; ++i)
     {
-        m_velocity.y *= -1.0f;
+        const float vx { reflect(positions[i].x, radii[i], velocities[i].x, 0.0f, width) };
+        const float vy { reflect(positions[i].y, radii[i], velocities[i].y, 0.0f, height) };
+        velocities[i].x = vx;
+        velocities[i].y = vy;
+        positions[i].x += vx * dt;
+        positions[i].y += vy * dt;
     }
+
+    if (m_collisions) { collide(width, height); }
+    else { m_hash_current = false; }
 }
 
-void Particle::evolve(const float width, const float height, const float dt)
+void Particles::collide(const float width, const float height)
 {
-    applyBoundaryCondition(width, height);
-    updatePosition(dt);
+    m_hash_current = false;
+    const float max_radius { m_radii.empty() ? 0.0f : *std::max_element(m_radii.begin(), m_radii.end()) };
+    if (!(max_radius > 0.0f)) { return; }
+
+    const float cell_size { 2.0f * max_radius };
+    const glm::vec2 domain { width, height };
+    if (cell_size != m_hash.cellSize() || domain != m_hash_size)
+    {
+        m_hash = SpatialHash(glm::vec2(0.0f, 0.0f), domain, cell_size);
+        m_hash_size = domain;
+    }
+    m_hash.build(m_positions.data(), static_cast<unsigned int>(size()), m_threads);
+    m_hash_current = true;
+
+#ifdef _OPENMP
+    const int threads { m_threads == 0 ? omp_get_max_threads() : static_cast<int>(m_threads) };
+#endif
+
+    // every particle sums the impulses of all its contacts from the velocities at the start
+    // of the step and writes only its own, so particles are independent, like in the
+    // integration, and the order they are visited in does not matter
+    const long count { static_cast<long>(size()) };
+    m_next_velocities.resize(m_velocities.size());
+
+    // visited bin by bin, so consecutive particles look at mostly the same neighbours
+    const unsigned int* order { m_hash.begin(0, 0) };
+
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (long k = 0; k < count; ++k)
+    {
+        const long i { order[k] };
+        const glm::vec2 position { m_positions[static_cast<std::size_t>(i)] };
+        const glm::vec2 velocity { m_velocities[static_cast<std::size_t>(i)] };
+        const float radius { m_radii[static_cast<std::size_t>(i)] };
+        const float mass { radius * radius };
+        glm::vec2 change { 0.0f, 0.0f };
+
+        const unsigned int cx_begin { m_hash.cellX(position.x - cell_size) };
+        const unsigned int cx_end { m_hash.cellX(position.x + cell_size) };
+        const unsigned int cy_end { m_hash.cellY(position.y + cell_size) };
+        for (unsigned int cy = m_hash.cellY(position.y - cell_size); cy <= cy_end; ++cy)
+        {
+            const unsigned int* last { m_hash.end(cx_end, cy) };
+            for (const unsigned int* it = m_hash.begin(cx_begin, cy); it != last; ++it)
+            {
+                if (*it == static_cast<unsigned int>(i)) { continue; }
+
+                const glm::vec2 d { position - m_positions[*it] };
+                const float reach { radius + m_radii[*it] };
+                const float d2 { glm::dot(d, d) };
+                if (d2 >= reach * reach || d2 == 0.0f) { continue; }
+
+                // closing speed along the line of centres; pairs already separating are left alone
+                const float approach { glm::dot(velocity - m_velocities[*it], d) };
+                if (approach >= 0.0f) { continue; }
+
+                const float other_mass { m_radii[*it] * m_radii[*it] };
+                change -= (2.0f * other_mass / (mass + other_mass) * approach / d2) * d;
+            }
+        }
+        m_next_velocities[static_cast<std::size_t>(i)] = velocity + change;
+    }
+
+    std::swap(m_velocities, m_next_velocities);
 }
@@ -2,6 +2,7 @@
 
 #include <glm/glm.hpp>
 #include <vector>
+#include "../SpatialHash/SpatialHash.hpp"
 
 class Particle
 {
@@ -16,9 +17,9 @@ public:
         , m_velocity { velocity }
     {}
 
-    float radius() { return m_radius; }
-    glm::vec2 position() { return m_position; }
-    glm::vec2 velocity() { return m_velocity; }
+    float radius() const { return m_radius; }
+    const glm::vec2& position() const { return m_position; }
+    const glm::vec2& velocity() const { return m_velocity; }
 
     void setPosition(const glm::vec2 position) { m_position = position; }
     void setVelocity(const glm::vec2 velocity) { m_velocity = velocity; }
@@ -28,23 +29,62 @@ public:
     void evolve(const float width, const float height, const float dt);
 };
 
-// struct Particles
-// {
-// // private:
-// //     std::vector<glm::vec2> m_positions;
-// //     std::vector<glm::vec2> m_velocities;
-// //     std::vector<float> m_radii;
-// // public:
-
-//     std::vector<const Particle&> m_particles;
-
-//     Particles(std::vector<Particle> particles)
-//     {
-//         for (const Particle& particle : particles)
-//         {
-//             addParticle(particle);
-//         }
-//     }
-
-//     void addParticle(const Particle& particle) { m_particles.push_back(particle); }
-// };
+// Particles as parallel arrays, so the integration runs as one vectorized loop
+// over contiguous positions, velocities and radii, and Grid's metaball fills
+// read the arrays as they are. Same motion as Particle::evolve, unless
+// collisions are on.
+class Particles
+{
+private:
+    std::vector<glm::vec2> m_positions;
+    std::vector<glm::vec2> m_velocities;
+    std::vector<float> m_radii;
+    unsigned int m_threads { 1 };
+
+    // collisions: particles binned by position after every step, in bins as wide as the
+    // largest particle, so touching pairs are always in neighbouring bins
+    bool m_collisions { false };
+    SpatialHash m_hash;
+    glm::vec2 m_hash_size { 0.0f, 0.0f };
+    bool m_hash_current { false }; // m_hash holds the current positions
+    std::vector<glm::vec2> m_next_velocities;
+
+    void collide(const float width, const float height);
+
+public:
+    Particles() = default;
+    explicit Particles(const std::vector<Particle>& particles);
+
+    void add(const float radius, const glm::vec2& position, const glm::vec2& velocity);
+    void reserve(const std::size_t count);
+    void clear();
+    std::size_t size() const { return m_radii.size(); }
+
+    const std::vector<glm::vec2>& positions() const { return m_positions; }
+    const std::vector<glm::vec2>& velocities() const { return m_velocities; }
+    const std::vector<float>& radii() const { return m_radii; }
+    // writable access to the positions drops hash()
+    std::vector<glm::vec2>& positions()
+    {
+        m_hash_current = false;
+        return m_positions;
+    }
+    std::vector<glm::vec2>& velocities() { return m_velocities; }
+    std::vector<float>& radii() { return m_radii; }
+
+    // reflects every particle off the walls of [0, width] x [0, height], then moves it by velocity * dt;
+    // with collisions, then bounces every pair of particles that overlap and still approach each other
+    void evolve(const float width, const float height, const float dt);
+
+    // elastic collisions between particles, masses proportional to radius^2; each step
+    // costs O(count) while the particles stay about as dense as their size allows
+    bool collisions() const { return m_collisions; }
+    void setCollisions(const bool collisions) { m_collisions = collisions; }
+    // the bins of the last collision step while positions have not changed since, nullptr
+    // otherwise; BasicGrid's cutoff fill reuses them instead of binning the particles again
+    const SpatialHash* hash() const { return m_hash_current ? &m_hash : nullptr; }
+
+    // 1 integrates serially, 0 uses every available core; results are the same either way
+    unsigned int threads() const { return m_threads; }
+    void setThreads(const unsigned int threads) { m_threads = threads; }
+};
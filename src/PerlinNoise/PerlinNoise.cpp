@@ -1,6 +1,11 @@
 #include "PerlinNoise.hpp"
+#include "PerlinNoiseKernels.hpp"
 
+#include <algorithm>
+
+#include <cmath>
 #include <cstdlib>
+#include <ctime>
 #include <iostream>
 
 const std::vector<glm::vec3> PerlinNoise::gradients = {
@@ -9,6 +14,22 @@ const std::vector<glm::vec3> PerlinNoise::gradients = {
     {0.0f,1.0f,1.0f}, {0.0f,-1.0f,1.0f}, {0.0f,1.0f,-1.0f}, {0.0f,-1.0f,-1.0f}
 };
 
+namespace
+{
+    // hashed mode: the gradients of the four lattice rows around a sample row (bottom, top,
+    // bottom ceiling, top ceiling) over the columns it spans; consecutive sample rows in the
+    // same lattice row reuse them. They only depend on the seed and the lattice indices.
+    struct LatticeRows
+    {
+        std::uint32_t seed { 0 };
+        int y_idx { 0 };
+        int z_idx { 0 };
+        int first_column { 0 };
+        unsigned int columns { 0 };
+        std::vector<glm::vec3> gradients {};
+    };
+}
+
 std::mt19937 PerlinNoise::rng(std::random_device{}());
 std::uniform_real_distribution<float> PerlinNoise::angle_dist(0.0f, 2.0f * static_cast<float>(M_PI));
 std::uniform_real_distribution<float> PerlinNoise::z_dist(-1.0f, 1.0f);
@@ -17,11 +38,25 @@ PerlinNoise::PerlinNoise(const float width, const float height, const unsigned i
     : m_resolution { resolution }
     , m_width { width }
     , m_height { height }
+    , m_dx { width / static_cast<float>(resolution - 1) }
+    , m_dy { height / static_cast<float>(static_cast<unsigned int>(static_cast<float>(resolution) / (width / height)) - 1) }
 {
     m_node_gradients.reserve(resolution * resolution);
     select_gradients ? selectGradients() : randomGradients();
 }
 
+PerlinNoise::PerlinNoise(const float cell_width, const float cell_height, const std::uint32_t seed)
+    : m_hashed { true }
+    , m_seed { seed }
+    , m_resolution { 0 }
+    , m_width { cell_width }
+    , m_height { cell_height }
+    , m_dx { cell_width }
+    , m_dy { cell_height }
+    , m_node_gradients {}
+{
+}
+
 glm::vec3 PerlinNoise::randomVector()
 {
     float z { PerlinNoise::z_dist(PerlinNoise::rng) };
@@ -43,10 +78,13 @@ float PerlinNoise::smoothStep(float t) const
 
 void PerlinNoise::selectGradients()
 {
+    if (m_hashed) { return; }
+
     // seed rng
     std::srand(static_cast<unsigned int>(std::time({}))); // use current time as seed
 
-    for (unsigned int i = 0; i < m_resolution * m_resolution; ++i)
+    // floor and ceiling z layers
+    for (unsigned int i = 0; i < 2 * m_resolution * m_resolution; ++i)
     {
         unsigned int idx = static_cast<unsigned>(rand() % 12);
         m_node_gradients.push_back(gradients[idx]);
@@ -55,6 +93,8 @@ void PerlinNoise::selectGradients()
 
 void PerlinNoise::randomGradients()
 {
+    if (m_hashed) { return; }
+
     for (unsigned int i = 0; i < 2 * m_resolution * m_resolution; ++i)
     {
         m_node_gradients.emplace_back(randomVector());
@@ -63,6 +103,8 @@ void PerlinNoise::randomGradients()
 
 void PerlinNoise::nextZGradients()
 {
+    if (m_hashed) { return; }
+
     for (unsigned int i = 0; i < m_resolution * m_resolution; ++i)
     {
         m_node_gradients[i] = m_node_gradients[i + m_resolution * m_resolution];
@@ -70,20 +112,77 @@ void PerlinNoise::nextZGradients()
     }
 }
 
+void PerlinNoise::setOctaves(const unsigned int octaves, const float lacunarity, const float gain)
+{
+    m_octaves = std::max(octaves, 1u);
+    m_lacunarity = lacunarity;
+    m_gain = gain;
+}
+
+const glm::vec3& PerlinNoise::gradient(const int x_idx, const int y_idx, const int z_idx, const std::uint32_t seed) const
+{
+    if (!m_hashed)
+    {
+        return m_node_gradients[static_cast<std::size_t>(x_idx) + m_resolution * static_cast<std::size_t>(y_idx)
+                                + m_resolution * m_resolution * static_cast<std::size_t>(z_idx)];
+    }
+
+    // decorrelate the axes with odd multipliers, then a murmur3 finalizer spreads every input bit
+    std::uint32_t h { seed };
+    h ^= static_cast<std::uint32_t>(x_idx) * 0x8da6b343u;
+    h ^= static_cast<std::uint32_t>(y_idx) * 0xd8163841u;
+    h ^= static_cast<std::uint32_t>(z_idx) * 0xcb1ab31fu;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return gradients[h % 12];
+}
+
+std::uint32_t PerlinNoise::octaveSeed(const unsigned int octave) const
+{
+    // each octave its own lattice, so the octaves do not line up at the origin
+    return m_seed + octave * 0x9e3779b9u;
+}
+
+unsigned int PerlinNoise::cellIndex(const float s) const
+{
+    // the far domain edge belongs to the last cell rather than one past it
+    return static_cast<unsigned int>(std::clamp(static_cast<int>(std::floor(s)), 0, static_cast<int>(m_resolution) - 2));
+}
+
 float PerlinNoise::noise(const glm::vec2& xy, float z) const
 {
-    // Determine the aspect ratio
-    const float aspectRatio = m_width / m_height;
+    if (m_octaves == 1) { return octaveNoise(xy, z, m_seed); }
+
+    // weighted mean of the octaves in [-1, 1], mapped back to [0, 1]
+    float sum { 0.0f };
+    float weight { 0.0f };
+    float frequency { 1.0f };
+    float amplitude { 1.0f };
+    for (unsigned int o = 0; o < m_octaves; ++o)
+    {
+        sum += amplitude * (2.0f * octaveNoise(xy * frequency, z * frequency, octaveSeed(o)) - 1.0f);
+        weight += amplitude;
+        frequency *= m_lacunarity;
+        amplitude *= m_gain;
+    }
+    return (sum / weight + 1.0f) / 2.0f;
+}
 
-    float dx { m_width / (m_resolution - 1) };
-    float dy { m_height / (static_cast<unsigned int>(m_resolution / aspectRatio) - 1) };
-    // dz = 1
+float PerlinNoise::octaveNoise(const glm::vec2& xy, const float z, const std::uint32_t seed) const
+{
+    // dz = 1; the stored lattice clamps to its cells and only has one z layer
+    const int x_idx { m_hashed ? static_cast<int>(std::floor(xy.x / m_dx)) : static_cast<int>(cellIndex(xy.x / m_dx)) };
+    const int y_idx { m_hashed ? static_cast<int>(std::floor(xy.y / m_dy)) : static_cast<int>(cellIndex(xy.y / m_dy)) };
+    const int z_idx { m_hashed ? static_cast<int>(std::floor(z)) : 0 };
+    float xf { xy.x / m_dx - static_cast<float>(x_idx) };
+    float yf { xy.y / m_dy - static_cast<float>(y_idx) };
+    float zf = { z - std::floor(z) };
 
-    unsigned int x_idx { static_cast<unsigned int>(floor(xy.x / dx)) };
-    unsigned int y_idx { static_cast<unsigned int>(floor(xy.y / dy)) };
-    float xf { xy.x / dx - x_idx };
-    float yf { xy.y / dy - y_idx };
-    float zf = { z - floor(z) };
+    const float sx { smoothStep(xf) };
+    const float sy { smoothStep(yf) };
 
     // displacement vectors
     // --------------------
@@ -91,43 +190,156 @@ float PerlinNoise::noise(const glm::vec2& xy, float z) const
     const glm::vec3 bottomLeft { xf, yf, zf };
     const glm::vec3 topLeft { xf, yf - 1.0f, zf };
     const glm::vec3 bottomRight { xf - 1.0f, yf, zf };
-    const glm::vec3 topRight { xf - 1.0f, yf - 1.0, zf };
+    const glm::vec3 topRight { xf - 1.0f, yf - 1.0f, zf };
     
     const glm::vec3 bottomLeftCeiling { xf, yf, zf - 1.0f };
     const glm::vec3 topLeftCeiling { xf, yf - 1.0f, zf - 1.0f };
     const glm::vec3 bottomRightCeiling { xf - 1.0f, yf, zf - 1.0f };
-    const glm::vec3 topRightCeiling { xf - 1.0f, yf - 1.0, zf - 1.0f };
+    const glm::vec3 topRightCeiling { xf - 1.0f, yf - 1.0f, zf - 1.0f };
 
     return (
             lerp(
                 lerp(
-                    lerp(
-                        glm::dot(bottomLeft, m_node_gradients[x_idx + m_resolution * (y_idx + 0)]),
-                        glm::dot(bottomRight, m_node_gradients[x_idx + 1 + m_resolution * (y_idx + 0)]), 
-                        smoothStep(xf)
-                    ),
-                    lerp(
-                        glm::dot(topLeft, m_node_gradients[x_idx + m_resolution * (y_idx + 1)]),
-                        glm::dot(topRight, m_node_gradients[x_idx + 1 + m_resolution * (y_idx + 1)]), 
-                        smoothStep(xf)
-                    ),
-                    smoothStep(yf)
+                    lerp(glm::dot(bottomLeft, gradient(x_idx, y_idx, z_idx, seed)), glm::dot(bottomRight, gradient(x_idx + 1, y_idx, z_idx, seed)), sx),
+                    lerp(glm::dot(topLeft, gradient(x_idx, y_idx + 1, z_idx, seed)), glm::dot(topRight, gradient(x_idx + 1, y_idx + 1, z_idx, seed)), sx),
+                    sy
                 ),
                 lerp(
-                    lerp(
-                        glm::dot(bottomLeftCeiling, m_node_gradients[x_idx + m_resolution * (y_idx + 0) + m_resolution * m_resolution]),
-                        glm::dot(bottomRightCeiling, m_node_gradients[x_idx + 1 + m_resolution * (y_idx + 0) + m_resolution * m_resolution]), 
-                        smoothStep(xf)
-                    ),
-                    lerp(
-                        glm::dot(topLeftCeiling, m_node_gradients[x_idx + m_resolution * (y_idx + 1) + m_resolution * m_resolution]),
-                        glm::dot(topRightCeiling, m_node_gradients[x_idx + 1 + m_resolution * (y_idx + 1) + m_resolution * m_resolution]), 
-                        smoothStep(xf)
-                    ),
-                    smoothStep(yf)
+                    lerp(glm::dot(bottomLeftCeiling, gradient(x_idx, y_idx, z_idx + 1, seed)), glm::dot(bottomRightCeiling, gradient(x_idx + 1, y_idx, z_idx + 1, seed)), sx),
+                    lerp(glm::dot(topLeftCeiling, gradient(x_idx, y_idx + 1, z_idx + 1, seed)), glm::dot(topRightCeiling, gradient(x_idx + 1, y_idx + 1, z_idx + 1, seed)), sx),
+                    sy
                 ),
                 zf
             )
         + 1) / 2;
 
 }
+
+void PerlinNoise::noiseRow(const float x0, const float dx, const unsigned int count, const float y, const float z, float* out) const
+{
+    if (m_octaves == 1)
+    {
+        octaveRow(x0, dx, 1.0f, count, y, z, 0, out);
+        return;
+    }
+
+    // every octave is one pass of the row kernel into scratch, accumulated in place
+    thread_local std::vector<float> octave;
+    octave.resize(count);
+    std::fill(out, out + count, 0.0f);
+
+    float weight { 0.0f };
+    float frequency { 1.0f };
+    float amplitude { 1.0f };
+    for (unsigned int o = 0; o < m_octaves; ++o)
+    {
+        octaveRow(x0, dx, frequency, count, y * frequency, z * frequency, o, octave.data());
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            out[i] += amplitude * (2.0f * octave[i] - 1.0f);
+        }
+        weight += amplitude;
+        frequency *= m_lacunarity;
+        amplitude *= m_gain;
+    }
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        out[i] = (out[i] / weight + 1.0f) / 2.0f;
+    }
+}
+
+void PerlinNoise::octaveRow(const float x0, const float dx, const float frequency, const unsigned int count, const float y, const float z, const unsigned int octave, float* out) const
+{
+    if (count == 0) { return; }
+
+    // hashed: tables only for the lattice columns the row spans, found with the kernels' arithmetic
+    const int end_a { static_cast<int>(std::floor(x0 * frequency / m_dx)) };
+    const int end_b { static_cast<int>(std::floor((x0 + static_cast<float>(count - 1) * dx) * frequency / m_dx)) };
+    const int first_column { m_hashed ? std::min(end_a, end_b) : 0 };
+    const unsigned int columns { m_hashed ? static_cast<unsigned int>(std::max(end_a, end_b) - first_column) + 2 : m_resolution };
+    const int y_idx { m_hashed ? static_cast<int>(std::floor(y / m_dy)) : static_cast<int>(cellIndex(y / m_dy)) };
+    const int z_idx { m_hashed ? static_cast<int>(std::floor(z)) : 0 };
+    const float yf { y / m_dy - static_cast<float>(y_idx) };
+    const float zf { z - std::floor(z) };
+
+    // fold the y and z terms of every dot product into per-column tables
+    thread_local std::vector<float> tables;
+    tables.resize(8 * static_cast<std::size_t>(columns));
+    PerlinRow row {};
+    row.x0 = x0;
+    row.dx = dx;
+    row.frequency = frequency;
+    row.cell = m_dx;
+    row.first_idx = first_column;
+    row.last_idx = first_column + static_cast<int>(columns) - 2;
+    row.sy = smoothStep(yf);
+    row.zf = zf;
+
+    const glm::vec3* lattice_rows { nullptr };
+    if (m_hashed)
+    {
+        thread_local std::vector<LatticeRows> cache;
+        if (cache.size() <= octave) { cache.resize(octave + 1); }
+
+        LatticeRows& rows { cache[octave] };
+        const std::uint32_t seed { octaveSeed(octave) };
+        if (rows.gradients.empty() || rows.seed != seed || rows.y_idx != y_idx || rows.z_idx != z_idx
+            || rows.first_column != first_column || rows.columns != columns)
+        {
+            rows.seed = seed;
+            rows.y_idx = y_idx;
+            rows.z_idx = z_idx;
+            rows.first_column = first_column;
+            rows.columns = columns;
+            rows.gradients.resize(4 * static_cast<std::size_t>(columns));
+            for (unsigned int l = 0; l < 4; ++l)
+            {
+                for (unsigned int k = 0; k < columns; ++k)
+                {
+                    rows.gradients[l * columns + k] = gradient(first_column + static_cast<int>(k), y_idx + static_cast<int>(l & 1), z_idx + static_cast<int>(l >> 1), seed);
+                }
+            }
+        }
+        lattice_rows = rows.gradients.data();
+    }
+
+    for (unsigned int l = 0; l < 4; ++l)
+    {
+        const int dy_l { static_cast<int>(l & 1) };  // top rows
+        const int dz_l { static_cast<int>(l >> 1) }; // ceiling rows
+        const glm::vec3* gradients { m_hashed
+            ? lattice_rows + l * columns
+            : &m_node_gradients[m_resolution * static_cast<unsigned int>(y_idx + dy_l) + m_resolution * m_resolution * static_cast<unsigned int>(dz_l)] };
+        float* gx { &tables[2 * l * columns] };
+        float* c { gx + columns };
+
+        for (unsigned int k = 0; k < columns; ++k)
+        {
+            const glm::vec3& g { gradients[k] };
+            gx[k] = g.x;
+            c[k] = (yf - static_cast<float>(dy_l)) * g.y + (zf - static_cast<float>(dz_l)) * g.z;
+        }
+
+        row.gx[l] = gx;
+        row.c[l] = c;
+    }
+
+    selectPerlinRowKernel()(row, count, out);
+}
+
+void PerlinNoise::noiseGrid(const glm::vec2& origin, const float dx, const float dy, const unsigned int nx, const unsigned int ny, const float z, float* out, const unsigned int stride) const
+{
+    const std::size_t row_stride { stride == 0 ? nx : stride };
+
+    #pragma omp parallel for schedule(static)
+    for (unsigned int y_i = 0; y_i < ny; ++y_i)
+    {
+        noiseRow(origin.x, dx, nx, origin.y + static_cast<float>(y_i) * dy, z, out + static_cast<std::size_t>(y_i) * row_stride);
+    }
+}
+
+const char* PerlinNoise::kernelName()
+{
+    return perlinRowKernelName();
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <vector>
 #include <random>
 
@@ -9,21 +10,63 @@ class PerlinNoise
 private:
     static const std::vector<glm::vec3> gradients;
 
+    // hashed mode: lattice gradients are picked from `gradients` by hashing their
+    // integer coordinates with the seed, so nothing is stored and the lattice is unbounded
+    bool m_hashed { false };
+    std::uint32_t m_seed { 0 };
+
     unsigned int m_resolution;
     const float m_width, m_height;
+    // lattice spacing
+    const float m_dx, m_dy;
     std::vector<glm::vec3> m_node_gradients;
+
+    // fractal Brownian motion: octave o samples at lacunarity^o times the frequency, weighted gain^o
+    unsigned int m_octaves { 1 };
+    float m_lacunarity { 2.0f };
+    float m_gain { 0.5f };
+
     glm::vec3 randomVector();
+    unsigned int cellIndex(const float s) const;
+    // gradient of lattice node (x_idx, y_idx, z_idx); z_idx is the layer (0 or 1) when stored
+    const glm::vec3& gradient(const int x_idx, const int y_idx, const int z_idx, const std::uint32_t seed) const;
+    std::uint32_t octaveSeed(const unsigned int octave) const;
+    // a single octave
+    float octaveNoise(const glm::vec2& xy, const float z, const std::uint32_t seed) const;
+    // out[i] = octaveNoise({ (x0 + i * dx) * frequency, y }, z, octaveSeed(octave)); y and z already scaled
+    void octaveRow(const float x0, const float dx, const float frequency, const unsigned int count, const float y, const float z, const unsigned int octave, float* out) const;
 public:
     static std::mt19937 rng;
     static std::uniform_real_distribution<float> angle_dist;
     static std::uniform_real_distribution<float> z_dist;
 
     PerlinNoise(const float width, const float height, const unsigned int resolution, const bool select_gradients);
+    // hashed mode: lattice cells of cell_width x cell_height x 1 (in z) over all of space, in
+    // constant memory; time can run on in z without nextZGradients
+    PerlinNoise(const float cell_width, const float cell_height, const std::uint32_t seed);
 
     float lerp(float a, float b, float t) const;
     float smoothStep(float t) const;
+    // stored mode only; no-ops when hashed
     void selectGradients();
     void randomGradients();
     void nextZGradients();
+    bool hashed() const { return m_hashed; }
+
+    // sum `octaves` octaves (1: plain noise) in noise, noiseRow and noiseGrid; values stay in [0, 1].
+    // Each octave costs one row kernel pass, plus hashing the lattice columns it spans (reused by the
+    // rows within a lattice row), so octaves finer than the sample spacing cost more and only alias.
+    // Meant for the hashed mode: the stored lattice clamps x and y to its domain and wraps z at 1
+    void setOctaves(const unsigned int octaves, const float lacunarity = 2.0f, const float gain = 0.5f);
+    unsigned int octaves() const { return m_octaves; }
+
     float noise(const glm::vec2& xy, float z) const;
+
+    // batch evaluation, matches noise() to within float rounding
+    // row: out[i] = noise({ x0 + i * dx, y }, z) for i in [0, count)
+    void noiseRow(const float x0, const float dx, const unsigned int count, const float y, const float z, float* out) const;
+    // grid: nx * ny samples in row major order, rows `stride` values apart (0: packed), evaluated in parallel
+    void noiseGrid(const glm::vec2& origin, const float dx, const float dy, const unsigned int nx, const unsigned int ny, const float z, float* out, const unsigned int stride = 0) const;
+    // name of the row kernel picked for this CPU ("avx2", "sse4.1" or "scalar")
+    static const char* kernelName();
 };
@@ -0,0 +1,180 @@
+#include "PerlinNoiseKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    inline float lerp(const float a, const float b, const float t)
+    {
+        return a + (b - a) * t;
+    }
+
+    inline float smoothStep(const float t)
+    {
+        return ((6*t - 15)*t + 10)*t*t*t;
+    }
+
+    inline float sample(const PerlinRow& row, const unsigned int i)
+    {
+        const float xs { (row.x0 + static_cast<float>(i) * row.dx) * row.frequency / row.cell };
+        const int cell { std::clamp(static_cast<int>(std::floor(xs)), row.first_idx, row.last_idx) };
+        const float xf { xs - static_cast<float>(cell) };
+        const float sx { smoothStep(xf) };
+        const int x_idx { cell - row.first_idx };
+
+        float d[4];
+        for (unsigned int l = 0; l < 4; ++l)
+        {
+            const float left { xf * row.gx[l][x_idx] + row.c[l][x_idx] };
+            const float right { (xf - 1.0f) * row.gx[l][x_idx + 1] + row.c[l][x_idx + 1] };
+            d[l] = lerp(left, right, sx);
+        }
+
+        return (lerp(lerp(d[0], d[1], row.sy), lerp(d[2], d[3], row.sy), row.zf) + 1) / 2;
+    }
+
+    struct Selected
+    {
+        PerlinRowKernel kernel;
+        const char* name;
+    };
+
+    Selected select()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) { return { perlinRowAVX2, "avx2" }; }
+        if (__builtin_cpu_supports("sse4.1")) { return { perlinRowSSE41, "sse4.1" }; }
+#endif
+        return { perlinRowScalar, "scalar" };
+    }
+
+    const Selected& selected()
+    {
+        static const Selected s { select() };
+        return s;
+    }
+}
+
+void perlinRowScalar(const PerlinRow& row, const unsigned int count, float* out)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        out[i] = sample(row, i);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("sse4.1")))
+void perlinRowSSE41(const PerlinRow& row, const unsigned int count, float* out)
+{
+    const __m128 lane { _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f) };
+    const __m128 one { _mm_set1_ps(1.0f) };
+    const __m128i first_i { _mm_set1_epi32(row.first_idx) };
+    const __m128i last_i { _mm_set1_epi32(row.last_idx) };
+
+    alignas(16) int idx[4];
+
+    unsigned int i { 0 };
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 x { _mm_add_ps(_mm_set1_ps(row.x0), _mm_mul_ps(_mm_add_ps(_mm_set1_ps(static_cast<float>(i)), lane), _mm_set1_ps(row.dx))) };
+        const __m128 xs { _mm_div_ps(_mm_mul_ps(x, _mm_set1_ps(row.frequency)), _mm_set1_ps(row.cell)) };
+        const __m128i cell { _mm_min_epi32(_mm_max_epi32(_mm_cvttps_epi32(_mm_floor_ps(xs)), first_i), last_i) };
+        const __m128i x_idx { _mm_sub_epi32(cell, first_i) };
+        const __m128 xf { _mm_sub_ps(xs, _mm_cvtepi32_ps(cell)) };
+        const __m128 xf1 { _mm_sub_ps(xf, one) };
+        const __m128 sx { _mm_mul_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(6.0f), xf), _mm_set1_ps(15.0f)), xf), _mm_set1_ps(10.0f)),
+            _mm_mul_ps(_mm_mul_ps(xf, xf), xf)) };
+        _mm_store_si128(reinterpret_cast<__m128i*>(idx), x_idx);
+
+        __m128 d[4];
+        for (unsigned int l = 0; l < 4; ++l)
+        {
+            const float* gx { row.gx[l] };
+            const float* c { row.c[l] };
+            const __m128 left { _mm_add_ps(
+                _mm_mul_ps(xf, _mm_set_ps(gx[idx[3]], gx[idx[2]], gx[idx[1]], gx[idx[0]])),
+                _mm_set_ps(c[idx[3]], c[idx[2]], c[idx[1]], c[idx[0]])) };
+            const __m128 right { _mm_add_ps(
+                _mm_mul_ps(xf1, _mm_set_ps(gx[idx[3] + 1], gx[idx[2] + 1], gx[idx[1] + 1], gx[idx[0] + 1])),
+                _mm_set_ps(c[idx[3] + 1], c[idx[2] + 1], c[idx[1] + 1], c[idx[0] + 1])) };
+            d[l] = _mm_add_ps(left, _mm_mul_ps(_mm_sub_ps(right, left), sx));
+        }
+
+        const __m128 sy { _mm_set1_ps(row.sy) };
+        const __m128 floor_layer { _mm_add_ps(d[0], _mm_mul_ps(_mm_sub_ps(d[1], d[0]), sy)) };
+        const __m128 ceiling_layer { _mm_add_ps(d[2], _mm_mul_ps(_mm_sub_ps(d[3], d[2]), sy)) };
+        const __m128 value { _mm_add_ps(floor_layer, _mm_mul_ps(_mm_sub_ps(ceiling_layer, floor_layer), _mm_set1_ps(row.zf))) };
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(value, one), _mm_set1_ps(0.5f)));
+    }
+
+    for (; i < count; ++i)
+    {
+        out[i] = sample(row, i);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+void perlinRowAVX2(const PerlinRow& row, const unsigned int count, float* out)
+{
+    const __m256 lane { _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f) };
+    const __m256 one { _mm256_set1_ps(1.0f) };
+    const __m256i one_i { _mm256_set1_epi32(1) };
+    const __m256i first_i { _mm256_set1_epi32(row.first_idx) };
+    const __m256i last_i { _mm256_set1_epi32(row.last_idx) };
+
+    unsigned int i { 0 };
+    for (; i + 8 <= count; i += 8)
+    {
+        // not fused: the sample positions are rounded as PerlinNoise::noise sees them
+        const __m256 x { _mm256_add_ps(_mm256_set1_ps(row.x0), _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(static_cast<float>(i)), lane), _mm256_set1_ps(row.dx))) };
+        const __m256 xs { _mm256_div_ps(_mm256_mul_ps(x, _mm256_set1_ps(row.frequency)), _mm256_set1_ps(row.cell)) };
+        const __m256i cell { _mm256_min_epi32(_mm256_max_epi32(_mm256_cvttps_epi32(_mm256_floor_ps(xs)), first_i), last_i) };
+        const __m256i x_idx { _mm256_sub_epi32(cell, first_i) };
+        const __m256i x_idx1 { _mm256_add_epi32(x_idx, one_i) };
+        const __m256 xf { _mm256_sub_ps(xs, _mm256_cvtepi32_ps(cell)) };
+        const __m256 xf1 { _mm256_sub_ps(xf, one) };
+        const __m256 sx { _mm256_mul_ps(
+            _mm256_fmadd_ps(_mm256_fmsub_ps(_mm256_set1_ps(6.0f), xf, _mm256_set1_ps(15.0f)), xf, _mm256_set1_ps(10.0f)),
+            _mm256_mul_ps(_mm256_mul_ps(xf, xf), xf)) };
+
+        __m256 d[4];
+        for (unsigned int l = 0; l < 4; ++l)
+        {
+            const __m256 left { _mm256_fmadd_ps(xf, _mm256_i32gather_ps(row.gx[l], x_idx, 4), _mm256_i32gather_ps(row.c[l], x_idx, 4)) };
+            const __m256 right { _mm256_fmadd_ps(xf1, _mm256_i32gather_ps(row.gx[l], x_idx1, 4), _mm256_i32gather_ps(row.c[l], x_idx1, 4)) };
+            d[l] = _mm256_fmadd_ps(_mm256_sub_ps(right, left), sx, left);
+        }
+
+        const __m256 sy { _mm256_set1_ps(row.sy) };
+        const __m256 floor_layer { _mm256_fmadd_ps(_mm256_sub_ps(d[1], d[0]), sy, d[0]) };
+        const __m256 ceiling_layer { _mm256_fmadd_ps(_mm256_sub_ps(d[3], d[2]), sy, d[2]) };
+        const __m256 value { _mm256_fmadd_ps(_mm256_sub_ps(ceiling_layer, floor_layer), _mm256_set1_ps(row.zf), floor_layer) };
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_add_ps(value, one), _mm256_set1_ps(0.5f)));
+    }
+
+    for (; i < count; ++i)
+    {
+        out[i] = sample(row, i);
+    }
+}
+
+#endif
+
+PerlinRowKernel selectPerlinRowKernel()
+{
+    return selected().kernel;
+}
+
+const char* perlinRowKernelName()
+{
+    return selected().name;
+}
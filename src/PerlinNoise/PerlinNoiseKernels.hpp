@@ -0,0 +1,35 @@
+#pragma once
+
+// Batch row kernels behind PerlinNoise::noiseRow.
+//
+// Every sample in a row shares y and z, so the y and z terms of each gradient
+// dot product are folded into per-lattice-column tables before the kernel runs;
+// the kernels only evaluate the x terms, the fade curve and the lerps.
+struct PerlinRow
+{
+    // samples are taken at (x0 + i * dx) * frequency, in lattice units divided by cell, the
+    // same arithmetic as PerlinNoise::noise, so the cell and its fraction come out the same
+    float x0, dx, frequency;
+    float cell;          // lattice spacing in x
+    int first_idx;       // lattice cells in x are clamped to [first_idx, last_idx];
+    int last_idx;        // the tables below start at column first_idx
+    float sy;            // smoothStep(yf)
+    float zf;
+
+    // indexed by lattice column, for the bottom, top, bottom ceiling and top ceiling lattice rows
+    const float* gx[4];  // gradient x component
+    const float* c[4];   // (yf - dy) * gradient.y + (zf - dz) * gradient.z
+};
+
+using PerlinRowKernel = void (*)(const PerlinRow& row, const unsigned int count, float* out);
+
+void perlinRowScalar(const PerlinRow& row, const unsigned int count, float* out);
+
+#if defined(__x86_64__) || defined(__i386__)
+void perlinRowSSE41(const PerlinRow& row, const unsigned int count, float* out);
+void perlinRowAVX2(const PerlinRow& row, const unsigned int count, float* out);
+#endif
+
+// picks the widest kernel the running CPU supports (once)
+PerlinRowKernel selectPerlinRowKernel();
+const char* perlinRowKernelName();
@@ -5,9 +5,10 @@
 class Point
 {
 private:
-    glm::vec2 m_position;
+    glm::vec2 m_position {};
 
 public:
+    Point() = default;
     Point(const float v1, const float v2);
 
     const glm::vec2& position() const { return m_position; }
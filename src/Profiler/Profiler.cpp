@@ -0,0 +1,298 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+    struct Percentiles
+    {
+        double p50, p99;
+    };
+
+    // nearest rank; sorts `samples`
+    Percentiles percentiles(std::vector<double>& samples)
+    {
+        if (samples.empty()) { return { 0.0, 0.0 }; }
+        std::sort(samples.begin(), samples.end());
+        auto rank = [&](const double p)
+        {
+            const std::size_t i { static_cast<std::size_t>(p * static_cast<double>(samples.size()) + 0.999999) };
+            return samples[std::clamp<std::size_t>(i, 1, samples.size()) - 1];
+        };
+        return { rank(0.50), rank(0.99) };
+    }
+
+    double toMs(const std::uint64_t ns) { return static_cast<double>(ns) / 1e6; }
+    double toUs(const std::uint64_t ns) { return static_cast<double>(ns) / 1e3; }
+
+    // names are literals from the code, so quotes and backslashes are all that needs escaping
+    void writeName(std::ostream& out, const char* name)
+    {
+        out << '"';
+        for (const char* c = name; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\') { out << '\\'; }
+            out << *c;
+        }
+        out << '"';
+    }
+
+    // the trace's time zero; taken at load time, as a zone reads its begin time before
+    // it first touches (and constructs) the profiler
+    const std::uint64_t load_time { Profiler::now() };
+}
+
+Profiler::Profiler()
+    : m_epoch { load_time != 0 ? load_time : now() }
+    , m_mutex {}
+    , m_rings {}
+    , m_frames {}
+{
+    m_frame_begin = m_epoch;
+}
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+std::uint64_t Profiler::now()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+Profiler::Ring& Profiler::ring()
+{
+    // rings are never freed, so a thread's zones outlive it
+    thread_local Ring* ring { nullptr };
+    if (!ring)
+    {
+        std::lock_guard<std::mutex> lock { m_mutex };
+        m_rings.push_back(std::make_unique<Ring>());
+        ring = m_rings.back().get();
+        ring->tid = static_cast<unsigned int>(m_rings.size());
+    }
+    return *ring;
+}
+
+void Profiler::record(const char* name, const std::uint64_t begin, const std::uint64_t end)
+{
+    Ring& thread_ring { ring() };
+    const std::uint64_t n { thread_ring.written.load(std::memory_order_relaxed) };
+    Event& event { thread_ring.events[n % ring_events] };
+    event.name.store(name, std::memory_order_relaxed);
+    event.begin.store(begin, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+    thread_ring.written.store(n + 1, std::memory_order_release);
+}
+
+void Profiler::count(const Counter counter, const std::uint64_t n)
+{
+    // single writer, so no read-modify-write is needed
+    std::atomic<std::uint64_t>& value { ring().counters[static_cast<std::size_t>(counter)] };
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+void Profiler::nameThread(const char* name)
+{
+    ring().name.store(name, std::memory_order_relaxed);
+}
+
+std::uint64_t Profiler::total(const Counter counter) const
+{
+    std::lock_guard<std::mutex> lock { m_mutex };
+    std::uint64_t sum { 0 };
+    for (const std::unique_ptr<Ring>& thread_ring : m_rings)
+    {
+        sum += thread_ring->counters[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+std::uint64_t Profiler::frames() const
+{
+    std::lock_guard<std::mutex> lock { m_mutex };
+    return m_frame_count;
+}
+
+const char* Profiler::counterName(const Counter counter)
+{
+    switch (counter)
+    {
+        case Counter::CellsScanned: return "cells_scanned";
+        case Counter::ActiveCells: return "active_cells";
+        case Counter::Vertices: return "vertices";
+        case Counter::BufferGrowths: return "buffer_growths";
+        default: return "unknown";
+    }
+}
+
+void Profiler::endFrame()
+{
+    std::array<std::uint64_t, counter_count> totals {};
+    for (std::size_t c = 0; c < counter_count; ++c) { totals[c] = total(static_cast<Counter>(c)); }
+    const std::uint64_t end { now() };
+
+    std::lock_guard<std::mutex> lock { m_mutex };
+    FrameSample sample { m_frame_begin, end, {} };
+    for (std::size_t c = 0; c < counter_count; ++c) { sample.counts[c] = totals[c] - m_frame_totals[c]; }
+
+    if (m_frames.size() < frame_window) { m_frames.push_back(sample); }
+    else { m_frames[m_frame_count % frame_window] = sample; }
+    ++m_frame_count;
+    m_frame_begin = end;
+    m_frame_totals = totals;
+}
+
+void Profiler::writeChromeTrace(std::ostream& out) const
+{
+    std::lock_guard<std::mutex> lock { m_mutex };
+
+    // complete ("X") events in microseconds since the library was loaded, one tid per ring;
+    // fixed to the nanosecond, as the default precision loses it after about a second
+    const std::ios::fmtflags flags { out.flags() };
+    const std::streamsize precision { out.precision() };
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first { true };
+    auto separate = [&] { out << (first ? "\n" : ",\n"); first = false; };
+
+    for (const std::unique_ptr<Ring>& thread_ring : m_rings)
+    {
+        const char* thread_name { thread_ring->name.load(std::memory_order_relaxed) };
+        if (thread_name)
+        {
+            separate();
+            out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << thread_ring->tid << ",\"args\":{\"name\":";
+            writeName(out, thread_name);
+            out << "}}";
+        }
+
+        const std::uint64_t written { thread_ring->written.load(std::memory_order_acquire) };
+        for (std::uint64_t n = written - std::min<std::uint64_t>(written, ring_events); n < written; ++n)
+        {
+            const Event& event { thread_ring->events[n % ring_events] };
+            const char* name { event.name.load(std::memory_order_relaxed) };
+            const std::uint64_t begin { event.begin.load(std::memory_order_relaxed) };
+            const std::uint64_t end { event.end.load(std::memory_order_relaxed) };
+            if (!name || end < begin) { continue; }
+
+            // a zone can only start before the epoch if the profiler was first used during static initialization
+            const std::uint64_t start { std::max(begin, m_epoch) };
+            separate();
+            out << "{\"ph\":\"X\",\"name\":";
+            writeName(out, name);
+            out << ",\"pid\":1,\"tid\":" << thread_ring->tid << ",\"ts\":" << toUs(start - m_epoch) << ",\"dur\":" << toUs(end - start) << '}';
+        }
+    }
+
+    // counter tracks, one sample per frame in the window, in frame order
+    const std::size_t frames { m_frames.size() };
+    for (std::size_t k = 0; k < frames; ++k)
+    {
+        const FrameSample& sample { m_frames[(m_frame_count - frames + k) % frame_window] };
+        separate();
+        out << "{\"ph\":\"C\",\"name\":\"counters\",\"pid\":1,\"tid\":0,\"ts\":" << toUs(sample.end - m_epoch) << ",\"args\":{";
+        for (std::size_t c = 0; c < counter_count; ++c)
+        {
+            out << (c ? "," : "") << '"' << counterName(static_cast<Counter>(c)) << "\":" << sample.counts[c];
+        }
+        out << "}}";
+    }
+    out << "\n]}\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) const
+{
+    std::ofstream file { path };
+    if (!file)
+    {
+        std::cerr << "Profiler: cannot open " << path << '\n';
+        return false;
+    }
+    writeChromeTrace(file);
+    return static_cast<bool>(file);
+}
+
+void Profiler::writeSummary(std::ostream& out) const
+{
+    std::lock_guard<std::mutex> lock { m_mutex };
+
+    std::vector<double> samples;
+    samples.reserve(std::max<std::size_t>(m_frames.size(), ring_events));
+    auto writeStats = [&](const char* unit)
+    {
+        const std::size_t n { samples.size() };
+        const Percentiles p { percentiles(samples) };
+        out << "{\"count\":" << n << ",\"p50" << unit << "\":" << p.p50 << ",\"p99" << unit << "\":" << p.p99 << '}';
+    };
+
+    out << "{\"totals\":{";
+    for (std::size_t c = 0; c < counter_count; ++c)
+    {
+        std::uint64_t sum { 0 };
+        for (const std::unique_ptr<Ring>& thread_ring : m_rings) { sum += thread_ring->counters[c].load(std::memory_order_relaxed); }
+        out << (c ? "," : "") << '"' << counterName(static_cast<Counter>(c)) << "\":" << sum;
+    }
+    out << "},\"frames\":" << m_frame_count << ",\"frame_ms\":";
+    samples.clear();
+    for (const FrameSample& sample : m_frames) { samples.push_back(toMs(sample.end - sample.begin)); }
+    writeStats("");
+
+    out << ",\"per_frame\":{";
+    for (std::size_t c = 0; c < counter_count; ++c)
+    {
+        samples.clear();
+        for (const FrameSample& sample : m_frames) { samples.push_back(static_cast<double>(sample.counts[c])); }
+        out << (c ? "," : "") << '"' << counterName(static_cast<Counter>(c)) << "\":";
+        writeStats("");
+    }
+
+    // zones by name over every thread; names are compared by content, as the same
+    // literal can have several addresses
+    std::vector<const char*> names;
+    for (const std::unique_ptr<Ring>& thread_ring : m_rings)
+    {
+        const std::uint64_t written { thread_ring->written.load(std::memory_order_acquire) };
+        for (std::uint64_t n = written - std::min<std::uint64_t>(written, ring_events); n < written; ++n)
+        {
+            const char* name { thread_ring->events[n % ring_events].name.load(std::memory_order_relaxed) };
+            if (name && std::none_of(names.begin(), names.end(), [&](const char* known) { return !std::strcmp(known, name); }))
+            {
+                names.push_back(name);
+            }
+        }
+    }
+
+    out << "},\"zones\":{";
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+        samples.clear();
+        for (const std::unique_ptr<Ring>& thread_ring : m_rings)
+        {
+            const std::uint64_t written { thread_ring->written.load(std::memory_order_acquire) };
+            for (std::uint64_t n = written - std::min<std::uint64_t>(written, ring_events); n < written; ++n)
+            {
+                const Event& event { thread_ring->events[n % ring_events] };
+                const char* name { event.name.load(std::memory_order_relaxed) };
+                const std::uint64_t begin { event.begin.load(std::memory_order_relaxed) };
+                const std::uint64_t end { event.end.load(std::memory_order_relaxed) };
+                if (name && end >= begin && !std::strcmp(name, names[i])) { samples.push_back(toMs(end - begin)); }
+            }
+        }
+        out << (i ? "," : "");
+        writeName(out, names[i]);
+        out << ':';
+        writeStats("_ms");
+    }
+    out << "}}\n";
+}
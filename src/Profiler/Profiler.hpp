@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Instrumentation of the hot paths: timed zones and event counters, recorded
+// per thread without locks and exported as a Chrome trace (chrome://tracing,
+// Perfetto) or as p50/p99 statistics over the most recent frames and zones.
+//
+// Code is instrumented through the PROFILE_* macros below, which compile to
+// nothing unless MS_PROFILE is defined (make PROFILE=1), so release builds pay
+// nothing for them.
+
+enum class Counter : unsigned char
+{
+    CellsScanned,  // cells MarchingSquares classified
+    ActiveCells,   // of those, cells with a crossing
+    Vertices,      // points the marches emitted
+    BufferGrowths, // reused buffers that had to reallocate (see BufferTracker)
+    Count
+};
+
+class Profiler
+{
+public:
+    // zones kept per thread; older ones are overwritten
+    static constexpr unsigned int ring_events { 8192 };
+    // frames the frame statistics cover
+    static constexpr unsigned int frame_window { 512 };
+    static constexpr std::size_t counter_count { static_cast<std::size_t>(Counter::Count) };
+
+    static Profiler& instance();
+    // nanoseconds on a steady clock
+    static std::uint64_t now();
+
+    // adds a zone to the calling thread's ring; `name` must outlive the profiler (a string literal)
+    void record(const char* name, const std::uint64_t begin, const std::uint64_t end);
+    void count(const Counter counter, const std::uint64_t n);
+    // label of the calling thread in the trace; must outlive the profiler
+    void nameThread(const char* name);
+    // ends a frame at now(), keeping its duration and the counts since the previous one
+    void endFrame();
+    std::uint64_t frames() const;
+
+    // summed over every thread since the start
+    std::uint64_t total(const Counter counter) const;
+    static const char* counterName(const Counter counter);
+
+    // the zones still in the rings, the thread names and one counter sample per frame.
+    // Zones are read while other threads may still record; one that is overwritten
+    // during the export can come out torn, so export while the instrumented threads are idle
+    void writeChromeTrace(std::ostream& out) const;
+    // false (and a message on stderr) if the file cannot be written
+    bool writeChromeTrace(const std::string& path) const;
+    // one JSON object: the counter totals, p50/p99 of the frame time and the per frame counts
+    // over the last frame_window frames, and of every zone over the zones still in the rings
+    void writeSummary(std::ostream& out) const;
+
+private:
+    struct Event
+    {
+        std::atomic<const char*> name { nullptr };
+        std::atomic<std::uint64_t> begin { 0 };
+        std::atomic<std::uint64_t> end { 0 };
+    };
+
+    // written by its thread only; the atomics (all relaxed) let the exports read it meanwhile
+    struct Ring
+    {
+        std::array<Event, ring_events> events {};
+        std::atomic<std::uint64_t> written { 0 };
+        std::array<std::atomic<std::uint64_t>, counter_count> counters {};
+        std::atomic<const char*> name { nullptr };
+        unsigned int tid { 0 };
+    };
+
+    struct FrameSample
+    {
+        std::uint64_t begin, end;
+        std::array<std::uint64_t, counter_count> counts;
+    };
+
+    const std::uint64_t m_epoch;
+
+    mutable std::mutex m_mutex; // guards the lists below, not the rings' contents
+    std::vector<std::unique_ptr<Ring>> m_rings;
+    std::vector<FrameSample> m_frames; // ring of the last frame_window frames
+    std::uint64_t m_frame_count { 0 };
+    std::uint64_t m_frame_begin { 0 };
+    std::array<std::uint64_t, counter_count> m_frame_totals {};
+
+    Profiler();
+    // the calling thread's ring, registered on first use
+    Ring& ring();
+};
+
+// times its scope as one zone
+class ProfileZone
+{
+private:
+    const char* m_name;
+    std::uint64_t m_begin;
+
+public:
+    explicit ProfileZone(const char* name)
+        : m_name { name }
+        , m_begin { Profiler::now() }
+    {}
+    ~ProfileZone() { Profiler::instance().record(m_name, m_begin, Profiler::now()); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+#ifdef MS_PROFILE
+#define PROFILE_JOIN_(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN_(a, b)
+#define PROFILE_ZONE(name) const ProfileZone PROFILE_JOIN(profile_zone_, __LINE__) { name }
+#define PROFILE_COUNT(counter, n) Profiler::instance().count(counter, static_cast<std::uint64_t>(n))
+#define PROFILE_THREAD(name) Profiler::instance().nameThread(name)
+#define PROFILE_FRAME() Profiler::instance().endFrame()
+#else
+// the arguments are not evaluated
+#define PROFILE_ZONE(name) static_cast<void>(0)
+#define PROFILE_COUNT(counter, n) static_cast<void>(0)
+#define PROFILE_THREAD(name) static_cast<void>(0)
+#define PROFILE_FRAME() static_cast<void>(0)
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+// IEEE 754 binary16 storage; arithmetic happens in float
+struct Half
+{
+    std::uint16_t bits { 0 };
+
+    Half() = default;
+    explicit Half(const float value) : bits { fromFloat(value) } {}
+    explicit operator float() const { return toFloat(bits); }
+
+    // round to nearest even, overflow to infinity
+    static std::uint16_t fromFloat(const float value)
+    {
+        const std::uint32_t x { std::bit_cast<std::uint32_t>(value) };
+        const std::uint32_t sign { (x >> 16) & 0x8000u };
+        const std::uint32_t magnitude { x & 0x7fffffffu };
+
+        if (magnitude >= 0x7f800000u) { return static_cast<std::uint16_t>(sign | (magnitude > 0x7f800000u ? 0x7e00u : 0x7c00u)); }
+        if (magnitude >= 0x477ff000u) { return static_cast<std::uint16_t>(sign | 0x7c00u); }
+        if (magnitude < 0x38800000u)
+        {
+            // subnormal: a multiple of 2^-24, scaling by 2^24 is exact
+            const float scaled { std::bit_cast<float>(magnitude) * 16777216.0f };
+            return static_cast<std::uint16_t>(sign | static_cast<std::uint32_t>(std::lrint(scaled)));
+        }
+
+        // rebias the exponent and round away the low 13 mantissa bits
+        std::uint32_t rebiased { magnitude - 0x38000000u };
+        rebiased += 0x0fffu + ((rebiased >> 13) & 1u);
+        return static_cast<std::uint16_t>(sign | (rebiased >> 13));
+    }
+
+    static float toFloat(const std::uint16_t bits)
+    {
+        const std::uint32_t sign { static_cast<std::uint32_t>(bits & 0x8000u) << 16 };
+        const std::uint32_t exponent { (bits >> 10) & 0x1fu };
+        const std::uint32_t mantissa { bits & 0x3ffu };
+
+        if (exponent == 0)
+        {
+            const float subnormal { static_cast<float>(mantissa) * (1.0f / 16777216.0f) };
+            return sign ? -subnormal : subnormal;
+        }
+        if (exponent == 31) { return std::bit_cast<float>(sign | 0x7f800000u | (mantissa << 13)); }
+        return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+    }
+};
+
+// How Grid and MarchingSquares read and write a storage type: values are
+// compared and interpolated as compute_type, and fills compute in float (or
+// double) and store the result. Only these four types are instantiated.
+template <typename T>
+struct ScalarTraits;
+
+template <>
+struct ScalarTraits<float>
+{
+    using compute_type = float;
+    static constexpr const char* npy_descr { "<f4" };
+    static float compute(const float value) { return value; }
+    static float store(const float value) { return value; }
+};
+
+template <>
+struct ScalarTraits<double>
+{
+    using compute_type = double;
+    static constexpr const char* npy_descr { "<f8" };
+    static double compute(const double value) { return value; }
+    static double store(const double value) { return value; }
+};
+
+template <>
+struct ScalarTraits<Half>
+{
+    using compute_type = float;
+    static constexpr const char* npy_descr { "<f2" };
+    static float compute(const Half value) { return static_cast<float>(value); }
+    static Half store(const float value) { return Half(value); }
+};
+
+template <>
+struct ScalarTraits<std::uint16_t>
+{
+    using compute_type = float;
+    static constexpr const char* npy_descr { "<u2" };
+    static float compute(const std::uint16_t value) { return static_cast<float>(value); }
+    // rounded and clamped to [0, 65535]
+    static std::uint16_t store(const float value)
+    {
+        return static_cast<std::uint16_t>(std::lrint(std::fmin(std::fmax(value, 0.0f), 65535.0f)));
+    }
+};
@@ -0,0 +1,111 @@
+#include "SpatialHash.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace
+{
+    // fewer points than this per thread are not worth a thread
+    constexpr unsigned int min_chunk_points { 4096 };
+
+    // bins per axis are capped so that nx * ny + 1 fits in unsigned int
+    constexpr unsigned int max_bins { 65535 };
+
+    unsigned int chunkBegin(const unsigned int count, const unsigned int chunks, const unsigned int chunk)
+    {
+        return static_cast<unsigned int>(static_cast<std::uint64_t>(count) * chunk / chunks);
+    }
+
+    // floor(s) clamped to [0, last] in float, as the conversion is undefined outside int's range; NaN gives 0
+    unsigned int binIndex(const float s, const unsigned int last)
+    {
+        const float bin { std::floor(s) };
+        if (!(bin > 0.0f)) { return 0; }
+        return bin < static_cast<float>(last) ? static_cast<unsigned int>(bin) : last;
+    }
+
+    // bins covering `extent`; one if the cell size is not positive and finite
+    unsigned int binCount(const float extent, const float cell_size)
+    {
+        const float bins { std::ceil(extent / cell_size) };
+        if (!(cell_size > 0.0f) || !std::isfinite(cell_size) || !(bins > 1.0f)) { return 1; }
+        return bins < static_cast<float>(max_bins) ? static_cast<unsigned int>(bins) : max_bins;
+    }
+}
+
+SpatialHash::SpatialHash(const glm::vec2& origin, const glm::vec2& size, const float cell_size)
+    : m_origin { origin }
+    , m_cell_size { cell_size }
+    , m_inv_cell_size { 1.0f / cell_size }
+    , m_nx { binCount(size.x, cell_size) }
+    , m_ny { binCount(size.y, cell_size) }
+{
+}
+
+unsigned int SpatialHash::cellX(const float x) const
+{
+    return binIndex((x - m_origin.x) * m_inv_cell_size, m_nx - 1);
+}
+
+unsigned int SpatialHash::cellY(const float y) const
+{
+    return binIndex((y - m_origin.y) * m_inv_cell_size, m_ny - 1);
+}
+
+void SpatialHash::build(const glm::vec2* positions, const unsigned int count, const unsigned int threads)
+{
+#ifdef _OPENMP
+    const unsigned int max_chunks { threads == 0 ? static_cast<unsigned int>(omp_get_max_threads()) : threads };
+#else
+    const unsigned int max_chunks { 1 };
+#endif
+    // counting sort by bin, each thread counting and then placing one contiguous chunk
+    // of points; bins are laid out chunk after chunk, which keeps the serial order
+    const unsigned int chunks { std::clamp(count / min_chunk_points, 1u, std::max(max_chunks, 1u)) };
+    const unsigned int cells { m_nx * m_ny };
+    m_point_cells.resize(count);
+    m_entries.resize(count);
+    m_chunk_cursors.assign(static_cast<std::size_t>(chunks) * cells, 0);
+
+    #pragma omp parallel for schedule(static, 1) num_threads(chunks)
+    for (unsigned int chunk = 0; chunk < chunks; ++chunk)
+    {
+        unsigned int* counts { m_chunk_cursors.data() + static_cast<std::size_t>(chunk) * cells };
+        for (unsigned int i = chunkBegin(count, chunks, chunk); i < chunkBegin(count, chunks, chunk + 1); ++i)
+        {
+            const unsigned int cell { cellY(positions[i].y) * m_nx + cellX(positions[i].x) };
+            m_point_cells[i] = cell;
+            ++counts[cell];
+        }
+    }
+
+    m_cell_start.resize(cells + 1);
+    unsigned int total { 0 };
+    for (unsigned int c = 0; c < cells; ++c)
+    {
+        m_cell_start[c] = total;
+        for (unsigned int chunk = 0; chunk < chunks; ++chunk)
+        {
+            unsigned int& cursor { m_chunk_cursors[static_cast<std::size_t>(chunk) * cells + c] };
+            const unsigned int points { cursor };
+            cursor = total;
+            total += points;
+        }
+    }
+    m_cell_start[cells] = total;
+
+    #pragma omp parallel for schedule(static, 1) num_threads(chunks)
+    for (unsigned int chunk = 0; chunk < chunks; ++chunk)
+    {
+        unsigned int* cursors { m_chunk_cursors.data() + static_cast<std::size_t>(chunk) * cells };
+        for (unsigned int i = chunkBegin(count, chunks, chunk); i < chunkBegin(count, chunks, chunk + 1); ++i)
+        {
+            m_entries[cursors[m_point_cells[i]]++] = i;
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Uniform grid of square bins over a rectangular domain. Points outside the
+// domain are clamped into the border bins. build() counting-sorts point indices
+// by bin, so the points of a bin, and of a whole row of bins, are contiguous,
+// and in increasing index order within a bin. A domain more than 65535 bins
+// wide keeps 65535 (the rest clamps into the last), and a cell size that is
+// not positive and finite gives a single bin.
+class SpatialHash
+{
+private:
+    glm::vec2 m_origin { 0.0f, 0.0f };
+    float m_cell_size { 1.0f };
+    float m_inv_cell_size { 1.0f };
+    unsigned int m_nx { 1 };
+    unsigned int m_ny { 1 };
+
+    // m_entries[m_cell_start[c] .. m_cell_start[c + 1]) are the points in bin c
+    std::vector<unsigned int> m_cell_start;
+    std::vector<unsigned int> m_entries;
+    // scratch for build(): every point's bin, and per chunk of points the count, then the next slot, of each bin
+    std::vector<unsigned int> m_point_cells;
+    std::vector<unsigned int> m_chunk_cursors;
+
+public:
+    SpatialHash() = default;
+    SpatialHash(const glm::vec2& origin, const glm::vec2& size, const float cell_size);
+
+    // 1 sorts serially, 0 uses every available core; the result is the same either way
+    void build(const glm::vec2* positions, const unsigned int count, const unsigned int threads = 1);
+
+    unsigned int cellX(const float x) const;
+    unsigned int cellY(const float y) const;
+    unsigned int nx() const { return m_nx; }
+    unsigned int ny() const { return m_ny; }
+    float cellSize() const { return m_cell_size; }
+    const glm::vec2& origin() const { return m_origin; }
+
+    // point indices in bins [cx_begin, cx_end] x [cy, cy] (inclusive)
+    const unsigned int* begin(const unsigned int cx_begin, const unsigned int cy) const { return m_entries.data() + m_cell_start[cy * m_nx + cx_begin]; }
+    const unsigned int* end(const unsigned int cx_end, const unsigned int cy) const { return m_entries.data() + m_cell_start[cy * m_nx + cx_end + 1]; }
+};
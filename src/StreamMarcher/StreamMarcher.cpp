@@ -0,0 +1,44 @@
+#include "StreamMarcher.hpp"
+
+bool RawRowReader::read(float* row, const unsigned int width)
+{
+    const std::streamsize bytes { static_cast<std::streamsize>(width * sizeof(float)) };
+    m_in.read(reinterpret_cast<char*>(row), bytes);
+    return m_in.gcount() == bytes;
+}
+
+void RawSegmentSink::write(const std::vector<Point>& points)
+{
+    for (const Point& point : points)
+    {
+        const glm::vec2& pos { point.position() };
+        m_out.write(reinterpret_cast<const char*>(&pos.x), sizeof(float));
+        m_out.write(reinterpret_cast<const char*>(&pos.y), sizeof(float));
+    }
+}
+
+StreamMarcher::StreamMarcher(const unsigned int width, const glm::vec2& origin, const float dx, const float dy, const float isolevel, const bool interp)
+    : m_width { width }
+    , m_window { width, 2, origin, dx, dy }
+    , m_marcher { isolevel, interp, m_window }
+    , m_points {}
+{
+}
+
+std::size_t StreamMarcher::march(RowReader& reader, SegmentSink& sink)
+{
+    float* window { m_window.data() };
+    if (m_width < 2 || !reader.read(window, m_width)) { return 0; }
+
+    // each row read completes a cell row, then the row above it is done with and takes the next one
+    std::size_t rows { 1 };
+    while (reader.read(window + (rows % 2) * m_width, m_width))
+    {
+        const unsigned int y_i { static_cast<unsigned int>(rows - 1) };
+        m_points.clear();
+        m_marcher.marchRow(window + (y_i % 2) * m_width, window + (rows % 2) * m_width, y_i, m_points);
+        sink.write(m_points);
+        ++rows;
+    }
+    return rows;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "../Point/Point.hpp"
+#include "../Grid/Grid.hpp"
+#include "../MarchingSquares/MarchingSquares.hpp"
+
+// source of raster rows, top to bottom
+class RowReader
+{
+public:
+    virtual ~RowReader() = default;
+    // fills `row` with the next `width` values; false once the raster is exhausted
+    virtual bool read(float* row, const unsigned int width) = 0;
+};
+
+// receives the segments of one cell row at a time (endpoint pairs, as MarchingSquares::points())
+class SegmentSink
+{
+public:
+    virtual ~SegmentSink() = default;
+    virtual void write(const std::vector<Point>& points) = 0;
+};
+
+// raw native endian float32 rows from a file or pipe; a trailing partial row is dropped
+class RawRowReader : public RowReader
+{
+private:
+    std::istream& m_in;
+
+public:
+    explicit RawRowReader(std::istream& in) : m_in { in } {}
+    bool read(float* row, const unsigned int width) override;
+};
+
+// raw float32 x0 y0 x1 y1 per segment
+class RawSegmentSink : public SegmentSink
+{
+private:
+    std::ostream& m_out;
+
+public:
+    explicit RawSegmentSink(std::ostream& out) : m_out { out } {}
+    void write(const std::vector<Point>& points) override;
+};
+
+// Marches a raster of known width and unknown height while holding only two
+// rows of values: each row pulled from the reader completes one row of cells,
+// whose segments go straight to the sink. Nodes sit at origin + (x_i * dx, y_i * dy)
+// like Grid's, and every cell row goes through MarchingSquares::marchRow, so the
+// segments are the ones MarchingSquares emits for the whole raster, in the same order.
+class StreamMarcher
+{
+private:
+    unsigned int m_width;
+
+    // the sliding window: two rows of a grid that places its nodes, stream row y_i
+    // in window row y_i % 2; only marchRow() reads it, never its tile ranges
+    Grid m_window;
+    MarchingSquares m_marcher;
+    // the current cell row's output, reused across rows
+    std::vector<Point> m_points;
+
+public:
+    StreamMarcher(const unsigned int width, const glm::vec2& origin, const float dx, const float dy, const float isolevel, const bool interp);
+
+    // m_marcher refers to m_window
+    StreamMarcher(const StreamMarcher&) = delete;
+    StreamMarcher& operator=(const StreamMarcher&) = delete;
+
+    // returns the number of rows read
+    std::size_t march(RowReader& reader, SegmentSink& sink);
+
+    float getIsolevel() const { return m_marcher.getIsolevel(); }
+    void setIsolevel(const float isolevel) { m_marcher.setIsolevel(isolevel); }
+};
@@ -0,0 +1,59 @@
+#include "Volume.hpp"
+
+Volume::Volume(const float width, const float height, const float depth, const unsigned int resolution, float (*f)(const glm::vec3&))
+    : m_nx { resolution }
+    , m_ny { resolution }
+    , m_nz { resolution }
+    , m_values(static_cast<std::size_t>(resolution) * resolution * resolution, 0.0f)
+{
+    computeSpacing(width, height, depth);
+    assignValues(f);
+}
+
+Volume::Volume(const float width, const float height, const float depth, const unsigned int resolution, const PerlinNoise& perlin)
+    : m_nx { resolution }
+    , m_ny { resolution }
+    , m_nz { resolution }
+    , m_values(static_cast<std::size_t>(resolution) * resolution * resolution, 0.0f)
+{
+    computeSpacing(width, height, depth);
+    assignValues(perlin);
+}
+
+void Volume::computeSpacing(const float width, const float height, const float depth)
+{
+    m_dx = width / static_cast<float>(m_nx - 1);
+    m_dy = height / static_cast<float>(m_ny - 1);
+    m_dz = depth / static_cast<float>(m_nz - 1);
+}
+
+void Volume::assignValues(float (*f)(const glm::vec3&))
+{
+    #pragma omp parallel for schedule(static)
+    for (unsigned int z_i = 0; z_i < m_nz; ++z_i)
+    {
+        for (unsigned int y_i = 0; y_i < m_ny; ++y_i)
+        {
+            float* row { m_values.data() + index(0, y_i, z_i) };
+            for (unsigned int x_i = 0; x_i < m_nx; ++x_i)
+            {
+                row[x_i] = f(glm::vec3(x(x_i), y(y_i), z(z_i)));
+            }
+        }
+    }
+}
+
+void Volume::assignValues(const PerlinNoise& perlin)
+{
+    // the noise only holds a floor and a ceiling gradient layer, so z wraps at 1;
+    // stopping one slice short keeps the last slice from repeating the first
+    #pragma omp parallel for schedule(static)
+    for (unsigned int z_i = 0; z_i < m_nz; ++z_i)
+    {
+        const float noise_z { static_cast<float>(z_i) / static_cast<float>(m_nz) };
+        for (unsigned int y_i = 0; y_i < m_ny; ++y_i)
+        {
+            perlin.noiseRow(m_origin.x, m_dx, m_nx, y(y_i), noise_z, m_values.data() + index(0, y_i, z_i));
+        }
+    }
+}
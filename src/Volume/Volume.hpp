@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../PerlinNoise/PerlinNoise.hpp"
+
+// Scalar field sampled on a regular 3D lattice of resolution^3 nodes, the 3D
+// counterpart of Grid. Node (x_i, y_i, z_i) sits at origin + (x_i * dx, y_i * dy, z_i * dz)
+// and is stored at (z_i * ny + y_i) * nx + x_i, so every z slice is a packed row major
+// Grid-like plane.
+class Volume
+{
+private:
+    unsigned int m_nx;
+    unsigned int m_ny;
+    unsigned int m_nz;
+    glm::vec3 m_origin { 0.0f, 0.0f, 0.0f };
+    float m_dx { 0.0f };
+    float m_dy { 0.0f };
+    float m_dz { 0.0f };
+    std::vector<float> m_values;
+
+    void computeSpacing(const float width, const float height, const float depth);
+public:
+    Volume(const float width, const float height, const float depth, const unsigned int resolution, float (*f)(const glm::vec3&));
+    // samples the noise over one lattice layer in z: slice z_i at noise z = z_i / resolution
+    Volume(const float width, const float height, const float depth, const unsigned int resolution, const PerlinNoise& perlin);
+
+    // both fills are parallel over z slices
+    void assignValues(float (*f)(const glm::vec3&));
+    void assignValues(const PerlinNoise& perlin);
+
+    std::size_t size() const { return m_values.size(); }
+    unsigned int nx() const { return m_nx; }
+    unsigned int ny() const { return m_ny; }
+    unsigned int nz() const { return m_nz; }
+    const glm::vec3& origin() const { return m_origin; }
+    float dx() const { return m_dx; }
+    float dy() const { return m_dy; }
+    float dz() const { return m_dz; }
+
+    float x(const unsigned int x_i) const { return m_origin.x + static_cast<float>(x_i) * m_dx; }
+    float y(const unsigned int y_i) const { return m_origin.y + static_cast<float>(y_i) * m_dy; }
+    float z(const unsigned int z_i) const { return m_origin.z + static_cast<float>(z_i) * m_dz; }
+    std::size_t index(const unsigned int x_i, const unsigned int y_i, const unsigned int z_i) const
+    {
+        return (static_cast<std::size_t>(z_i) * m_ny + y_i) * m_nx + x_i;
+    }
+
+    const std::vector<float>& values() const { return m_values; }
+    const float* data() const { return m_values.data(); }
+    float* data() { return m_values.data(); }
+    void setValue(const float val, const std::size_t idx) { m_values[idx] = val; }
+};
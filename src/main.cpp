@@ -14,6 +14,8 @@
 #include "Grid/Grid.hpp"
 #include "MarchingSquares/MarchingSquares.hpp"
 #include "PerlinNoise/PerlinNoise.hpp"
+#include "FramePipeline/FramePipeline.hpp"
+#include "Profiler/Profiler.hpp"
 
 SDL_Window* window;
 SDL_GLContext gl_context;
@@ -32,8 +34,6 @@ const unsigned int res { 250 };
 float DELTA_TIME; // { 1.0f / FRAME_RATE};
 Uint32 CURRENT_TIME { 0 };
 Uint32 LAST_TIME { 0 };
-// Uint64 START_TICK_COUNT, END_TICK_COUNT;
-// float ELAPSED_MS;
 
 float GLOBAL_TIME { 0.0f };
 float DT { 0.025f };
@@ -55,7 +55,7 @@ void set_sdl_gl_attributes()
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
 }
 
-void arrowKeyIsolevel(SDL_Event& event, MarchingSquares& msq)
+void arrowKeyIsolevel(SDL_Event& event, float& level)
 {
     float di { 0.005f };
 
@@ -63,13 +63,13 @@ void arrowKeyIsolevel(SDL_Event& event, MarchingSquares& msq)
     {
         if (event.key.keysym.scancode == SDL_SCANCODE_DOWN)
         {
-            msq.setIsolevel(std::clamp(msq.getIsolevel() - di, 0.0f, 1.0f));
-            std::cout << msq.getIsolevel() << '\n';
+            level = std::clamp(level - di, 0.0f, 1.0f);
+            std::cout << level << '\n';
         }
         else if (event.key.keysym.scancode == SDL_SCANCODE_UP)
         {
-            msq.setIsolevel(std::clamp(msq.getIsolevel() + di, 0.0f, 1.0f));
-            std::cout << msq.getIsolevel() << '\n';
+            level = std::clamp(level + di, 0.0f, 1.0f);
+            std::cout << level << '\n';
         }
     }
 }
@@ -160,7 +160,9 @@ int main()
         // particles.emplace_back(15.0f, glm::vec2(width * 3.0f/4.0f, height/2), glm::vec2(width/30, -height/10));
         
         // Grid grid(width, height, res, true, particles);
-        PerlinNoise p(width, height, 10, false);
+        // hashed gradients, so time runs on in z without nextZGradients mutating the
+        // noise under the pipeline's worker; same lattice spacing as a 10 x 10 stored lattice
+        PerlinNoise p(width / 9, height / 9, static_cast<std::uint32_t>(std::random_device{}()));
         Grid grid(width, height, res, p);
         std::vector<Circle> point_circles;
         point_circles.reserve(grid.size());
@@ -217,7 +219,8 @@ int main()
         // IndexBuffer line_circ_IBO(e_circles.m_indices.data(), static_cast<unsigned int>(e_circles.m_indices.size()));
         // END HERE
 
-        VertexBuffer line_VBO(MSq.positions().data(), static_cast<unsigned int>(MSq.positions().size() * sizeof(float)), GL_DYNAMIC_DRAW);
+        const std::vector<float> line_positions { MSq.positions() };
+        VertexBuffer line_VBO(line_positions.data(), static_cast<unsigned int>(line_positions.size() * sizeof(float)), GL_DYNAMIC_DRAW);
 
         // `colored_line` stuff
         // std::vector<float> colored_line_VB;
@@ -275,14 +278,24 @@ int main()
 
         Renderer renderer;
 
+        // frame N + 1 is filled and marched on a worker thread while frame N is uploaded
+        // and drawn here; double buffered, so the contours on screen are one frame behind
+        // the input at most
+        FramePipeline pipeline(
+            [&] { return Grid(width, height, res, p); }, isolevel, interp,
+            [&](FramePipeline::Frame& frame) { frame.grid.assignValues(p, frame.time); }
+            // [&](FramePipeline::Frame& frame) { frame.grid.assignValues(particles); }
+        );
+        float level { isolevel };
+        pipeline.submit(GLOBAL_TIME, level);
+
         // Main loop
         SDL_Event event;
         is_running = true;
 
+        PROFILE_THREAD("main");
         while(is_running)
         {
-            // START_TICK_COUNT = SDL_GetPerformanceCounter();
-            
             // CURRENT_TIME = SDL_GetTicks();
             // DELTA_TIME = fminf(static_cast<float>(CURRENT_TIME - LAST_TIME) / 1000.0f, 0.025f);
             // evolve particles
@@ -299,53 +312,67 @@ int main()
                     is_running = false;
                 }
 
-                arrowKeyIsolevel(event, MSq);
+                arrowKeyIsolevel(event, level);
                 evolveTime(event);
                 renderNoise(event);
             }
 
             if (not paused) { GLOBAL_TIME += DT / 5; }
-            
-            // update z layer if reached the ceiling
-            if (GLOBAL_TIME >= 0.99999f)
-            {
-                GLOBAL_TIME = 0.0f;
-                p.nextZGradients();
-            }
 
-            // update grid values
-            grid.assignValues(p, GLOBAL_TIME);
-            // grid.assignValues(particles);
-            MSq.march(grid);
+            // start the next frame, then take the current one
+            pipeline.submit(GLOBAL_TIME, level);
+            const FramePipeline::Frame* frame { pipeline.acquire() };
 
             // update circle buffer
-            circles.updateColors(values);
-            VBO.updateBuffer(circles.m_vertices.data());
+            {
+                PROFILE_ZONE("upload circles");
+                circles.updateColors(frame->grid.values());
+                VBO.updateBuffer(circles.m_vertices.data());
+            }
             
-            // update line buffer (rebuffer because the size of the buffer is non-constant)
-            std::vector<float> positions = MSq.positions();
-            line_VBO.rebuffer(positions.data(), static_cast<unsigned int>(positions.size() * sizeof(float)), GL_DYNAMIC_DRAW);
-
-            // Render
-            renderer.clear();
+            // update line buffer (rebuffer because the size of the buffer is non-constant; drawLines
+            // takes the vertex count from it). This is the only copy of the contour per frame:
+            // the worker flattened it into frame->positions, whose capacity is reused
+            {
+                PROFILE_ZONE("upload lines");
+                line_VBO.rebuffer(frame->positions.data(), static_cast<unsigned int>(frame->positions.size() * sizeof(float)), GL_DYNAMIC_DRAW);
+            }
 
-            // to show grid point values in color
-            if (showNoise) { renderer.drawCircles(VAO, IBO, shader); }
-            // renderer.drawCircles(line_circ_VAO, line_circ_IBO, shader);
-            
-            renderer.drawLines(line_VAO, line_VBO, line_shader);
-            // renderer.drawLines(line_VAO, colored_line_VBO, line_shader);
+            // the buffers hold their own copies now, so the worker may reuse the slot
+            pipeline.release();
 
-            SDL_GL_SwapWindow(window);
+            // Render
+            {
+                PROFILE_ZONE("draw");
+                renderer.clear();
+
+                // to show grid point values in color
+                if (showNoise) { renderer.drawCircles(VAO, IBO, shader); }
+                // renderer.drawCircles(line_circ_VAO, line_circ_IBO, shader);
+                
+                renderer.drawLines(line_VAO, line_VBO, line_shader);
+                // renderer.drawLines(line_VAO, colored_line_VBO, line_shader);
+            }
 
-            // END_TICK_COUNT = SDL_GetPerformanceCounter();
-            // ELAPSED_MS = static_cast<float>((END_TICK_COUNT - START_TICK_COUNT) / SDL_GetPerformanceFrequency()) * 1000.0f;
-            // SDL_Delay((Uint32)(DELTA_TIME * 1000.0f - ELAPSED_MS));
+            {
+                PROFILE_ZONE("swap");
+                SDL_GL_SwapWindow(window);
+            }
 
-            // float elapsed = static_cast<float>(end - start) / (float)SDL_GetPerformanceFrequency();
-            // std::cout << "Current FPS: " << std::to_string(1.0f / elapsed) << std::endl;
+            // built with PROFILE=1: frame times and counts, summarized every 600 frames
+            PROFILE_FRAME();
+#ifdef MS_PROFILE
+            if (Profiler::instance().frames() % 600 == 0) { Profiler::instance().writeSummary(std::cout); }
+#endif
         }
 
+#ifdef MS_PROFILE
+        // let the worker finish the frame in flight, so nothing records while the rings are read
+        while (pipeline.acquire()) { pipeline.release(); }
+        Profiler::instance().writeChromeTrace("trace.json");
+        Profiler::instance().writeSummary(std::cout);
+#endif
+
         SDL_Quit();
     }
     else
@@ -0,0 +1,137 @@
+// Checks for AdaptiveMarcher: where the contour only runs through finest leaves it must
+// be, segment for segment, the uniform march of the equivalent Grid, and where leaves of
+// different depths meet it must stay crack free, every endpoint inside the domain shared
+// by exactly two segments.
+//
+// usage: AdaptiveMarcherTest   (exit status 1 if a check fails)
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "AdaptiveMarcher/AdaptiveMarcher.hpp"
+#include "Grid/Grid.hpp"
+#include "MarchingSquares/MarchingSquares.hpp"
+
+namespace
+{
+    const float size { 768.0f };
+    const unsigned int base_cells { 16 };
+    const unsigned int max_depth { 4 };
+
+    int failures { 0 };
+
+    float circle(const glm::vec2& p)
+    {
+        return 1.0f - glm::length(p - glm::vec2(380.0f, 400.0f)) / 250.0f;
+    }
+
+    // islands a few finest cells across: a leaf next to the one that finds an island can
+    // miss it with all of its samples and stay coarse, so the contour also crosses edges
+    // between leaves of different depths
+    std::vector<glm::vec2> island_centers;
+    const float island_radius { 5.0f };
+
+    float islands(const glm::vec2& p)
+    {
+        float value { 0.0f };
+        for (const glm::vec2& center : island_centers)
+        {
+            value = std::max(value, 1.0f - glm::length(p - center) / island_radius);
+        }
+        return value;
+    }
+
+    void report(const std::string& name, const bool ok)
+    {
+        std::cerr << name << (ok ? ": ok\n" : ": FAILED\n");
+        if (!ok) { ++failures; }
+    }
+
+    using Segment = std::tuple<float, float, float, float>;
+
+    // segments with their endpoints in a fixed order, sorted
+    std::vector<Segment> segments(const std::vector<Point>& points)
+    {
+        std::vector<Segment> out;
+        for (std::size_t i = 0; i + 1 < points.size(); i += 2)
+        {
+            std::tuple<float, float> a { points[i].position().x, points[i].position().y };
+            std::tuple<float, float> b { points[i + 1].position().x, points[i + 1].position().y };
+            if (b < a) { std::swap(a, b); }
+            out.emplace_back(std::get<0>(a), std::get<1>(a), std::get<0>(b), std::get<1>(b));
+        }
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+    // endpoints strictly inside [0, extent]^2 used by other than exactly two segments
+    unsigned int unpairedEndpoints(const std::vector<Point>& points, const float extent)
+    {
+        std::map<std::tuple<float, float>, unsigned int> uses;
+        for (const Point& point : points) { ++uses[{ point.position().x, point.position().y }]; }
+
+        unsigned int unpaired { 0 };
+        for (const auto& [position, count] : uses)
+        {
+            const auto [x, y] { position };
+            const bool boundary { x <= 0.0f || y <= 0.0f || x >= extent || y >= extent };
+            if (!boundary && count != 2) { ++unpaired; }
+        }
+        return unpaired;
+    }
+
+    void uniformMatch()
+    {
+        for (const bool interp : { false, true })
+        {
+            AdaptiveMarcher adaptive { size, size, base_cells, max_depth, 0.0f, interp };
+            adaptive.march(circle);
+            const Grid grid { size, size, adaptive.equivalentResolution(), circle };
+            MarchingSquares uniform { 0.0f, interp, grid };
+
+            const bool ok { !uniform.points().empty() && segments(adaptive.points()) == segments(uniform.points()) };
+            report(std::string("circle == uniform march, segment for segment") + (interp ? "" : " (midpoints)"), ok);
+        }
+    }
+
+    void crackFree()
+    {
+        std::mt19937 rng { 7 };
+        std::uniform_real_distribution<float> position(20.0f, size - 20.0f);
+        for (unsigned int i = 0; i < 400; ++i) { island_centers.emplace_back(position(rng), position(rng)); }
+
+        for (const bool interp : { false, true })
+        {
+            AdaptiveMarcher adaptive { size, size, base_cells, max_depth, 0.5f, interp };
+            adaptive.march(islands);
+            const float spacing { size / static_cast<float>(adaptive.equivalentResolution() - 1) };
+
+            // a segment spanning more than a finest cell in x or y crosses a coarser leaf
+            unsigned int coarse { 0 };
+            for (std::size_t i = 0; i + 1 < adaptive.points().size(); i += 2)
+            {
+                const glm::vec2 d { adaptive.points()[i + 1].position() - adaptive.points()[i].position() };
+                if (std::fabs(d.x) > 1.001f * spacing || std::fabs(d.y) > 1.001f * spacing) { ++coarse; }
+            }
+
+            const unsigned int unpaired { unpairedEndpoints(adaptive.points(), size) };
+            const bool ok { coarse > 0 && unpaired == 0 };
+            std::cerr << "islands" << (interp ? "" : " (midpoints)") << ": " << adaptive.leafCount() << " leaves, "
+                      << coarse << " segments across coarser leaves, " << unpaired << " unpaired endpoints\n";
+            report(std::string("islands across leaves of different depths, crack free") + (interp ? "" : " (midpoints)"), ok);
+        }
+    }
+}
+
+int main()
+{
+    uniformMatch();
+    crackFree();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+// Equivalence checks for ContourSet: every isoline must be exactly the segments
+// MarchingSquares finds at that level, on whichever grid was marched last, and the
+// parallel march must reproduce the serial one.
+//
+// usage: ContourSetTest   (exit status 1 if a check fails)
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "ContourSet/ContourSet.hpp"
+#include "Grid/Grid.hpp"
+#include "MarchingSquares/MarchingSquares.hpp"
+
+namespace
+{
+    const float width { 768.0f };
+    const float height { 768.0f };
+
+    int failures { 0 };
+
+    float waves(const glm::vec2& p)
+    {
+        return std::sin(p.x * 0.05f) * std::cos(p.y * 0.037f) + 0.3f * std::sin((p.x + p.y) * 0.11f);
+    }
+
+    float ripples(const glm::vec2& p)
+    {
+        return std::cos(glm::length(p - glm::vec2(300.0f, 400.0f)) * 0.04f);
+    }
+
+    void report(const char* name, const bool ok)
+    {
+        std::cerr << name << (ok ? ": ok\n" : ": FAILED\n");
+        if (!ok) { ++failures; }
+    }
+
+    bool samePoints(const std::vector<Point>& a, const std::vector<Point>& b)
+    {
+        if (a.size() != b.size()) { return false; }
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            if (!(a[i].position() == b[i].position())) { return false; }
+        }
+        return true;
+    }
+
+    // every level of `set` against a MarchingSquares march of `grid` at that level
+    bool matchesMarchingSquares(const ContourSet& set, const Grid& grid, const bool interp)
+    {
+        bool ok { true };
+        for (unsigned int k = 0; k < set.levelCount(); ++k)
+        {
+            MarchingSquares marcher { set.isolevels()[k], interp, grid };
+            ok = ok && samePoints(set.isoline(k), marcher.points());
+        }
+        return ok;
+    }
+
+    void singleLevel()
+    {
+        const Grid grid { width, height, 300, waves };
+        bool ok { true };
+        for (const bool interp : { false, true })
+        {
+            const ContourSet set { { 0.1f }, interp, grid };
+            ok = ok && matchesMarchingSquares(set, grid, interp);
+        }
+        report("single level == MarchingSquares", ok);
+    }
+
+    void manyLevels()
+    {
+        const Grid grid { width, height, 300, waves };
+        bool ok { true };
+        for (const bool interp : { false, true })
+        {
+            const ContourSet set { { 0.6f, -0.5f, 0.1f, -0.05f, 1.0f }, interp, grid };
+            ok = ok && matchesMarchingSquares(set, grid, interp);
+        }
+        report("every level == MarchingSquares at that level", ok);
+    }
+
+    // march() takes the values, the resolution and the node positions from its argument
+    void anotherGrid()
+    {
+        const Grid first { width, height, 300, waves };
+        const Grid second { 500.0f, 600.0f, 173, ripples };
+        ContourSet set { { -0.3f, 0.2f }, true, first };
+        set.march(second);
+        report("march of another grid == MarchingSquares on it", matchesMarchingSquares(set, second, true));
+    }
+
+    void serialParallel()
+    {
+        const Grid grid { width, height, 300, waves };
+        ContourSet serial { { -0.5f, 0.1f, 0.6f }, true, grid };
+        serial.setIsobands(true);
+        serial.march(grid);
+        ContourSet parallel { { -0.5f, 0.1f, 0.6f }, true, grid };
+        parallel.setIsobands(true);
+        parallel.setThreads(4);
+        parallel.march(grid);
+
+        bool ok { true };
+        for (unsigned int k = 0; k < serial.levelCount(); ++k) { ok = ok && samePoints(serial.isoline(k), parallel.isoline(k)); }
+        for (unsigned int k = 0; k + 1 < serial.levelCount(); ++k) { ok = ok && samePoints(serial.isoband(k), parallel.isoband(k)); }
+        report("serial == 4 threads (isolines, isobands)", ok);
+    }
+}
+
+int main()
+{
+    singleLevel();
+    manyLevels();
+    anotherGrid();
+    serialParallel();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,220 @@
+// Regression checks for Grid: an incremental march after any sequence of fills must
+// find the same contour as a fresh march of the same values, and the cutoff fill must
+// cope with any cutoff and any particle position.
+//
+// usage: GridTest   (exit status 1 if a check fails)
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "Grid/Grid.hpp"
+#include "MarchingSquares/MarchingSquares.hpp"
+#include "Particle/Particle.hpp"
+
+namespace
+{
+    const float width { 768.0f };
+    const float height { 768.0f };
+    const unsigned int resolution { 250 };
+    const float isolevel { 0.5f };
+
+    int failures { 0 };
+
+    std::vector<Particle> makeParticles(const unsigned int count)
+    {
+        std::mt19937 rng { 1234 };
+        std::uniform_real_distribution<float> radius_dist(2.0f, 12.0f);
+        std::uniform_real_distribution<float> x_dist(0.0f, width);
+        std::uniform_real_distribution<float> y_dist(0.0f, height);
+        std::vector<Particle> particles;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            particles.emplace_back(radius_dist(rng), glm::vec2(x_dist(rng), y_dist(rng)), glm::vec2(0.0f, 0.0f));
+        }
+        return particles;
+    }
+
+    float constant(const glm::vec2&) { return 0.0f; }
+
+    std::vector<std::tuple<float, float>> sorted(const std::vector<Point>& points)
+    {
+        std::vector<std::tuple<float, float>> out;
+        out.reserve(points.size());
+        for (const Point& point : points) { out.emplace_back(point.position().x, point.position().y); }
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+    // cells of the grid with a crossing, counted without the tile ranges
+    unsigned int crossedCells(const Grid& grid)
+    {
+        unsigned int crossed { 0 };
+        const float* values { grid.data() };
+        for (unsigned int y_i = 0; y_i + 1 < grid.rows(); ++y_i)
+        {
+            for (unsigned int x_i = 0; x_i + 1 < grid.resolution(); ++x_i)
+            {
+                const unsigned int nw { y_i * grid.stride() + x_i };
+                const int active {
+                    (values[nw] >= isolevel) + (values[nw + 1] >= isolevel) +
+                    (values[nw + grid.stride()] >= isolevel) + (values[nw + grid.stride() + 1] >= isolevel)
+                };
+                if (active != 0 && active != 4) { ++crossed; }
+            }
+        }
+        return crossed;
+    }
+
+    // `incremental` has marched the grid before its latest fill; compares its march of the
+    // latest values with a fresh one, and the fresh one with a scan that skips no tile
+    void check(const char* name, MarchingSquares& incremental, const Grid& grid)
+    {
+        incremental.march(grid);
+        MarchingSquares fresh { isolevel, true, grid };
+        fresh.march(grid);
+
+        const unsigned int cells { crossedCells(grid) };
+        const bool fresh_ok { (fresh.points().size() == 0) == (cells == 0) };
+        const bool incremental_ok { sorted(incremental.points()) == sorted(fresh.points()) };
+        if (!fresh_ok || !incremental_ok)
+        {
+            std::cerr << name << ": FAILED, incremental " << incremental.points().size() << " points, fresh "
+                      << fresh.points().size() << " points, " << cells << " crossed cells\n";
+            ++failures;
+        }
+        else
+        {
+            std::cerr << name << ": ok, " << fresh.points().size() << " points\n";
+        }
+    }
+
+    // same particles and cutoff, another falloff
+    void falloffChange()
+    {
+        const std::vector<Particle> particles { makeParticles(40) };
+        Grid grid { width, height, resolution, false, particles };
+        grid.assignValues(particles, 40.0f, Falloff::Inverse);
+        MarchingSquares incremental { isolevel, true, grid };
+        incremental.setIncremental(true);
+        incremental.march(grid);
+
+        grid.assignValues(particles, 40.0f, Falloff::Compact);
+        check("cutoff fill, then another falloff", incremental, grid);
+    }
+
+    // another fill in between two identical cutoff fills
+    void fillInBetween()
+    {
+        const std::vector<Particle> particles { makeParticles(40) };
+        Grid grid { width, height, resolution, false, particles };
+        grid.assignValues(particles, 40.0f);
+        MarchingSquares incremental { isolevel, true, grid };
+        incremental.setIncremental(true);
+        incremental.march(grid);
+
+        grid.assignValues(constant);
+        incremental.march(grid);
+        grid.assignValues(particles, 40.0f);
+        check("cutoff fill, function fill, same cutoff fill", incremental, grid);
+    }
+
+    // the exact fill records the particles too, and the default bins are as large as this cutoff
+    void exactThenCutoff()
+    {
+        const std::vector<Particle> particles { makeParticles(40) };
+        Grid grid { width, height, resolution, false, particles };
+        MarchingSquares incremental { isolevel, true, grid };
+        incremental.setIncremental(true);
+        incremental.march(grid);
+
+        grid.assignValues(particles, 1.0f);
+        check("exact fill, then cutoff fill", incremental, grid);
+    }
+
+    void report(const char* name, const bool ok)
+    {
+        std::cerr << name << (ok ? ": ok\n" : ": FAILED\n");
+        if (!ok) { ++failures; }
+    }
+
+    bool sameValues(const Grid& a, const Grid& b)
+    {
+        return std::equal(a.data(), a.data() + a.size(), b.data());
+    }
+
+    // a cutoff that is not positive and finite falls back to the exact sum
+    void invalidCutoff()
+    {
+        const std::vector<Particle> particles { makeParticles(40) };
+        const Grid exact { width, height, resolution, true, particles };
+        bool ok { true };
+        for (const float cutoff : { 0.0f, -5.0f, std::numeric_limits<float>::infinity(), std::numeric_limits<float>::quiet_NaN() })
+        {
+            Grid grid { width, height, resolution, true, particles };
+            grid.assignValues(constant);
+            grid.assignValues(particles, cutoff);
+            ok = ok && sameValues(grid, exact);
+        }
+        report("invalid cutoffs fall back to the exact sum", ok);
+    }
+
+    // fills after moving a few particles rewrite only the tiles around them, and must
+    // leave the same values as filling a fresh grid
+    void movedParticles()
+    {
+        std::vector<Particle> particles { makeParticles(200) };
+        Grid grid { width, height, resolution, false, particles };
+        grid.assignValues(particles, 40.0f);
+
+        std::mt19937 rng { 99 };
+        std::uniform_int_distribution<std::size_t> pick(0, particles.size() - 1);
+        std::uniform_real_distribution<float> step(-30.0f, 30.0f);
+        bool ok { true };
+        for (unsigned int frame = 0; frame < 20; ++frame)
+        {
+            for (unsigned int moved = 0; moved < 3; ++moved)
+            {
+                Particle& particle { particles[pick(rng)] };
+                particle.setPosition(particle.position() + glm::vec2(step(rng), step(rng)));
+            }
+            grid.assignValues(particles, 40.0f);
+            Grid fresh { width, height, resolution, false, particles };
+            fresh.assignValues(particles, 40.0f);
+            ok = ok && sameValues(grid, fresh);
+        }
+        report("cutoff fills after moving particles", ok);
+    }
+
+    // particles far outside the grid (beyond int's range in node units) add nothing
+    void farParticles()
+    {
+        std::vector<Particle> particles { makeParticles(40) };
+        Grid near { width, height, resolution, false, particles };
+        near.assignValues(particles, 40.0f);
+
+        for (const float far : { 1e12f, -1e12f, 1e30f, -1e30f })
+        {
+            particles.emplace_back(5.0f, glm::vec2(far, height / 2), glm::vec2(0.0f, 0.0f));
+            particles.emplace_back(5.0f, glm::vec2(width / 2, far), glm::vec2(0.0f, 0.0f));
+        }
+        Grid grid { width, height, resolution, false, particles };
+        grid.assignValues(particles, 40.0f);
+        report("particles far outside the grid", sameValues(grid, near));
+    }
+}
+
+int main()
+{
+    falloffChange();
+    fillInBetween();
+    exactThenCutoff();
+    invalidCutoff();
+    farParticles();
+    movedParticles();
+    return failures ? 1 : 0;
+}
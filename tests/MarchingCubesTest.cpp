@@ -0,0 +1,116 @@
+// Mesh checks for MarchingCubes on fields whose surface stays inside the volume: the
+// mesh must be closed (every edge shared by exactly two triangles) and consistently
+// oriented (no directed edge used twice), and the parallel march must reproduce the
+// serial mesh exactly.
+//
+// usage: MarchingCubesTest   (exit status 1 if a check fails)
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MarchingCubes/MarchingCubes.hpp"
+#include "Volume/Volume.hpp"
+
+namespace
+{
+    const float size { 100.0f };
+    const unsigned int resolution { 48 };
+    const float isolevel { 0.5f };
+
+    int failures { 0 };
+
+    float sphere(const glm::vec3& p)
+    {
+        return 1.0f - glm::length(p - glm::vec3(50.0f, 50.0f, 50.0f)) / 40.0f;
+    }
+
+    // overlapping blobs, which cross many cells between two diagonal active corners
+    float blobs(const glm::vec3& p)
+    {
+        const glm::vec3 centers[4] { { 35.0f, 40.0f, 45.0f }, { 62.0f, 55.0f, 50.0f }, { 48.0f, 68.0f, 35.0f }, { 50.0f, 35.0f, 68.0f } };
+        float sum { 0.0f };
+        for (const glm::vec3& center : centers)
+        {
+            const glm::vec3 d { p - center };
+            sum += 120.0f / (glm::dot(d, d) + 1.0f);
+        }
+        return sum;
+    }
+
+    // ripples inside a ball, so the surface has many small pieces and saddles but never reaches the boundary
+    float ripples(const glm::vec3& p)
+    {
+        const float inside { 1.0f - glm::length(p - glm::vec3(50.0f, 50.0f, 50.0f)) / 45.0f };
+        const float waves { std::sin(p.x * 0.4f) * std::sin(p.y * 0.35f) * std::sin(p.z * 0.3f) };
+        return inside > 0.1f ? 0.5f + 0.6f * waves : 0.0f;
+    }
+
+    void report(const std::string& name, const bool ok)
+    {
+        std::cerr << name << (ok ? ": ok\n" : ": FAILED\n");
+        if (!ok) { ++failures; }
+    }
+
+    std::uint64_t edgeKey(const unsigned int from, const unsigned int to)
+    {
+        return static_cast<std::uint64_t>(from) << 32 | to;
+    }
+
+    // every undirected edge in exactly two triangles, every directed edge in at most one
+    bool closedAndOriented(const MarchingCubes& mesh)
+    {
+        const std::vector<unsigned int>& indices { mesh.indices() };
+        std::unordered_map<std::uint64_t, unsigned int> directed;
+        for (std::size_t i = 0; i < indices.size(); i += 3)
+        {
+            for (unsigned int k = 0; k < 3; ++k)
+            {
+                ++directed[edgeKey(indices[i + k], indices[i + (k + 1) % 3])];
+            }
+        }
+
+        for (const auto& [key, count] : directed)
+        {
+            const unsigned int from { static_cast<unsigned int>(key >> 32) };
+            const unsigned int to { static_cast<unsigned int>(key) };
+            const auto reverse { directed.find(edgeKey(to, from)) };
+            if (count != 1 || reverse == directed.end() || reverse->second != 1) { return false; }
+        }
+        return !indices.empty();
+    }
+
+    bool sameMesh(const MarchingCubes& a, const MarchingCubes& b)
+    {
+        return a.indices() == b.indices() && a.vertices().size() == b.vertices().size()
+            && std::equal(a.vertices().begin(), a.vertices().end(), b.vertices().begin());
+    }
+
+    void check(const char* name, float (*f)(const glm::vec3&))
+    {
+        const Volume volume { size, size, size, resolution, f };
+        for (const bool interp : { false, true })
+        {
+            MarchingCubes serial { isolevel, interp, volume };
+            MarchingCubes parallel { isolevel, interp, volume };
+            parallel.setThreads(8);
+            parallel.march(volume);
+
+            const std::string label { std::string(name) + (interp ? ", interpolated" : ", midpoints") };
+            report(label + ": closed and oriented", closedAndOriented(serial));
+            report(label + ": serial == 8 threads", sameMesh(serial, parallel));
+        }
+    }
+}
+
+int main()
+{
+    check("sphere", sphere);
+    check("blobs", blobs);
+    check("ripples", ripples);
+    return failures ? 1 : 0;
+}
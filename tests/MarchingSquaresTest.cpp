@@ -0,0 +1,194 @@
+// Equivalence checks for MarchingSquares: the parallel march must reproduce the serial
+// one exactly in every output mode, indexed output must expand to the plain segments,
+// and grids that hold the same values (mapped, or in another storage type) must give
+// the same contour.
+//
+// usage: MarchingSquaresTest   (exit status 1 if a check fails)
+
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Grid/Grid.hpp"
+#include "MappedRaster/MappedRaster.hpp"
+#include "MarchingSquares/MarchingSquares.hpp"
+
+namespace
+{
+    const float width { 768.0f };
+    const float height { 768.0f };
+    const unsigned int resolution { 300 };
+    const float isolevel { 0.1f };
+
+    int failures { 0 };
+
+    float waves(const glm::vec2& p)
+    {
+        return std::sin(p.x * 0.05f) * std::cos(p.y * 0.037f) + 0.3f * std::sin((p.x + p.y) * 0.11f);
+    }
+
+    // whole numbers in [100, 1900], which float, double, Half and uint16 all hold exactly
+    float steps(const glm::vec2& p)
+    {
+        return std::round(1000.0f + 900.0f * waves(p));
+    }
+
+    void report(const std::string& name, const bool ok)
+    {
+        std::cerr << name << (ok ? ": ok\n" : ": FAILED\n");
+        if (!ok) { ++failures; }
+    }
+
+    bool samePoints(const std::vector<Point>& a, const std::vector<Point>& b)
+    {
+        if (a.size() != b.size()) { return false; }
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            if (!(a[i].position() == b[i].position())) { return false; }
+        }
+        return true;
+    }
+
+    // same segments, every coordinate within `tolerance`
+    bool closePoints(const std::vector<Point>& a, const std::vector<Point>& b, const float tolerance)
+    {
+        if (a.size() != b.size()) { return false; }
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            const glm::vec2 d { a[i].position() - b[i].position() };
+            if (std::fabs(d.x) > tolerance || std::fabs(d.y) > tolerance) { return false; }
+        }
+        return true;
+    }
+
+    bool samePolylines(const std::vector<Polyline>& a, const std::vector<Polyline>& b)
+    {
+        if (a.size() != b.size()) { return false; }
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            if (a[i].first != b[i].first || a[i].count != b[i].count || a[i].closed != b[i].closed) { return false; }
+        }
+        return true;
+    }
+
+    MarchingSquares configured(const Grid& grid, const bool indexed, const bool polylines, const unsigned int threads)
+    {
+        MarchingSquares marcher { isolevel, true, grid };
+        marcher.setIndexed(indexed);
+        marcher.setPolylines(polylines);
+        marcher.setThreads(threads);
+        marcher.march(grid);
+        return marcher;
+    }
+
+    void serialParallel()
+    {
+        const Grid grid { width, height, resolution, waves };
+        for (const unsigned int threads : { 2u, 4u, 7u })
+        {
+            MarchingSquares serial { configured(grid, false, false, 1) };
+            MarchingSquares parallel { configured(grid, false, false, threads) };
+            bool ok { samePoints(serial.points(), parallel.points()) };
+
+            MarchingSquares serial_indexed { configured(grid, true, false, 1) };
+            MarchingSquares parallel_indexed { configured(grid, true, false, threads) };
+            ok = ok && samePoints(serial_indexed.points(), parallel_indexed.points())
+                && serial_indexed.indices() == parallel_indexed.indices();
+
+            MarchingSquares serial_lines { configured(grid, false, true, 1) };
+            MarchingSquares parallel_lines { configured(grid, false, true, threads) };
+            ok = ok && samePoints(serial_lines.points(), parallel_lines.points())
+                && serial_lines.indices() == parallel_lines.indices()
+                && samePolylines(serial_lines.polylineList(), parallel_lines.polylineList())
+                && serial_lines.polylineVertices() == parallel_lines.polylineVertices();
+
+            report("serial == " + std::to_string(threads) + " threads (plain, indexed, polylines)", ok);
+        }
+    }
+
+    void indexedExpansion()
+    {
+        const Grid grid { width, height, resolution, waves };
+        bool ok { true };
+        for (const bool interp : { false, true })
+        {
+            MarchingSquares plain { isolevel, interp, grid };
+            MarchingSquares indexed { isolevel, interp, grid };
+            indexed.setIndexed(true);
+            indexed.march(grid);
+
+            std::vector<Point> expanded;
+            for (const unsigned int id : indexed.indices()) { expanded.push_back(indexed.points()[id]); }
+            ok = ok && samePoints(expanded, plain.points());
+        }
+        report("indexed output expands to the segment soup", ok);
+    }
+
+    // with whole number values the cases agree exactly; the interpolated crossings may differ
+    // in the last bit where double computes the lerp parameter before rounding it to float
+    template <typename T>
+    void storageType(const char* name)
+    {
+        const Grid reference { width, height, resolution, steps };
+        const BasicGrid<T> grid { width, height, resolution, steps };
+        bool ok { true };
+        for (const bool interp : { false, true })
+        {
+            MarchingSquares expected { 1000.5f, interp, reference };
+            BasicMarchingSquares<T> marcher { 1000.5f, interp, grid };
+            ok = ok && (interp ? closePoints(marcher.points(), expected.points(), 1e-3f) : samePoints(marcher.points(), expected.points()));
+        }
+        report(name, ok);
+    }
+
+    // the owned grid's values written out with padded rows, mapped back and marched in place
+    void mappedGrid()
+    {
+        const Grid owned { width, height, resolution, waves };
+        const unsigned int stride { resolution + 5 };
+        const std::filesystem::path path { std::filesystem::temp_directory_path() / "MarchingSquaresTest.raw" };
+        {
+            std::ofstream out { path, std::ios::binary };
+            const std::vector<float> padding(stride - resolution, 0.0f);
+            for (unsigned int y_i = 0; y_i < owned.rows(); ++y_i)
+            {
+                out.write(reinterpret_cast<const char*>(owned.data() + y_i * owned.stride()), resolution * sizeof(float));
+                out.write(reinterpret_cast<const char*>(padding.data()), static_cast<std::streamsize>(padding.size() * sizeof(float)));
+            }
+        }
+
+        bool ok { false };
+        {
+            MappedRaster raster { path.string(), resolution, stride };
+            if (raster.valid())
+            {
+                const Grid mapped { std::move(raster), owned.origin(), owned.dx(), owned.dy() };
+                MarchingSquares expected { configured(owned, false, false, 1) };
+                MarchingSquares marcher { configured(mapped, false, false, 1) };
+                MarchingSquares expected_indexed { configured(owned, true, false, 4) };
+                MarchingSquares marcher_indexed { configured(mapped, true, false, 4) };
+                ok = mapped.rows() == owned.rows()
+                    && samePoints(marcher.points(), expected.points())
+                    && samePoints(marcher_indexed.points(), expected_indexed.points())
+                    && marcher_indexed.indices() == expected_indexed.indices();
+            }
+        }
+        std::filesystem::remove(path);
+        report("mapped grid == owned grid", ok);
+    }
+}
+
+int main()
+{
+    serialParallel();
+    indexedExpansion();
+    storageType<double>("double grid == float grid");
+    storageType<Half>("Half grid == float grid");
+    storageType<std::uint16_t>("uint16 grid == float grid");
+    mappedGrid();
+    return failures ? 1 : 0;
+}
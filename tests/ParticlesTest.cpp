@@ -0,0 +1,155 @@
+// Checks for Particles collisions: the binned step must bounce exactly the pairs an
+// all-pairs search finds, give bitwise the same result on any number of threads, and
+// keep the kinetic energy and momentum of an isolated collision.
+//
+// usage: ParticlesTest   (exit status 1 if a check fails)
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Particle/Particle.hpp"
+
+namespace
+{
+    const float width { 300.0f };
+    const float height { 300.0f };
+    const float dt { 0.05f };
+
+    int failures { 0 };
+
+    void report(const std::string& name, const bool ok)
+    {
+        std::cerr << name << (ok ? ": ok\n" : ": FAILED\n");
+        if (!ok) { ++failures; }
+    }
+
+    // particles of mixed sizes crowded enough that many touch every step
+    Particles crowd()
+    {
+        std::mt19937 rng { 11 };
+        std::uniform_real_distribution<float> position(5.0f, width - 5.0f);
+        std::uniform_real_distribution<float> velocity(-20.0f, 20.0f);
+        std::uniform_real_distribution<float> radius(1.0f, 4.0f);
+        Particles particles;
+        for (unsigned int i = 0; i < 2000; ++i)
+        {
+            particles.add(radius(rng), { position(rng), position(rng) }, { velocity(rng), velocity(rng) });
+        }
+        particles.setCollisions(true);
+        return particles;
+    }
+
+    // the collision step over every pair, from the velocities at the start of the step
+    std::vector<glm::vec2> allPairs(const Particles& particles)
+    {
+        const std::vector<glm::vec2>& positions { particles.positions() };
+        const std::vector<glm::vec2>& velocities { particles.velocities() };
+        const std::vector<float>& radii { particles.radii() };
+        std::vector<glm::vec2> next { velocities };
+        for (std::size_t i = 0; i < particles.size(); ++i)
+        {
+            for (std::size_t j = 0; j < particles.size(); ++j)
+            {
+                if (i == j) { continue; }
+                const glm::vec2 d { positions[i] - positions[j] };
+                const float reach { radii[i] + radii[j] };
+                const float d2 { glm::dot(d, d) };
+                if (d2 >= reach * reach || d2 == 0.0f) { continue; }
+                const float approach { glm::dot(velocities[i] - velocities[j], d) };
+                if (approach >= 0.0f) { continue; }
+                const float mass { radii[i] * radii[i] };
+                const float other_mass { radii[j] * radii[j] };
+                next[i] -= (2.0f * other_mass / (mass + other_mass) * approach / d2) * d;
+            }
+        }
+        return next;
+    }
+
+    // every step against the all-pairs step from the same state; the impulses of a
+    // particle are summed in another order, so the velocities agree to rounding
+    void allPairsReference()
+    {
+        Particles particles { crowd() };
+        bool ok { true };
+        unsigned int bounced { 0 };
+        for (unsigned int frame = 0; frame < 20; ++frame)
+        {
+            Particles moved { particles };
+            moved.setCollisions(false);
+            moved.evolve(width, height, dt);
+            const std::vector<glm::vec2> expected { allPairs(moved) };
+
+            particles.evolve(width, height, dt);
+            for (std::size_t i = 0; i < particles.size(); ++i)
+            {
+                const glm::vec2 d { particles.velocities()[i] - expected[i] };
+                const float tolerance { 1e-4f * (1.0f + glm::length(expected[i])) };
+                ok = ok && particles.positions()[i] == moved.positions()[i]
+                    && std::fabs(d.x) <= tolerance && std::fabs(d.y) <= tolerance;
+                if (!(moved.velocities()[i] == expected[i])) { ++bounced; }
+            }
+        }
+        std::cerr << "crowd: " << bounced << " velocities changed by collisions in 20 steps\n";
+        report("binned collisions == all pairs", ok && bounced > 0);
+    }
+
+    void serialParallel()
+    {
+        Particles serial { crowd() };
+        Particles parallel { crowd() };
+        parallel.setThreads(4);
+        for (unsigned int frame = 0; frame < 50; ++frame)
+        {
+            serial.evolve(width, height, dt);
+            parallel.evolve(width, height, dt);
+        }
+        report("serial == 4 threads, bitwise", serial.positions() == parallel.positions() && serial.velocities() == parallel.velocities());
+    }
+
+    // two particles of different sizes meet head on, then off centre, far from the walls
+    void twoBody()
+    {
+        for (const float offset : { 0.0f, 3.0f })
+        {
+            Particles particles;
+            particles.add(3.0f, { 100.0f, 150.0f }, { 30.0f, 0.0f });
+            particles.add(5.0f, { 200.0f, 150.0f + offset }, { -20.0f, 0.0f });
+            particles.setCollisions(true);
+
+            const auto energy = [&particles] {
+                float sum { 0.0f };
+                for (std::size_t i = 0; i < 2; ++i)
+                {
+                    sum += particles.radii()[i] * particles.radii()[i] * glm::dot(particles.velocities()[i], particles.velocities()[i]);
+                }
+                return 0.5f * sum;
+            };
+            const auto momentum = [&particles] {
+                return particles.radii()[0] * particles.radii()[0] * particles.velocities()[0]
+                    + particles.radii()[1] * particles.radii()[1] * particles.velocities()[1];
+            };
+
+            const float energy_before { energy() };
+            const glm::vec2 momentum_before { momentum() };
+            const glm::vec2 velocity_before { particles.velocities()[0] };
+            for (unsigned int frame = 0; frame < 60; ++frame) { particles.evolve(width, height, dt); }
+
+            const glm::vec2 dp { momentum() - momentum_before };
+            const bool ok { !(particles.velocities()[0] == velocity_before)
+                && std::fabs(energy() - energy_before) <= 1e-5f * energy_before
+                && std::fabs(dp.x) <= 1e-3f && std::fabs(dp.y) <= 1e-3f };
+            report(offset == 0.0f ? "head on collision keeps energy and momentum" : "off centre collision keeps energy and momentum", ok);
+        }
+    }
+}
+
+int main()
+{
+    allPairsReference();
+    serialParallel();
+    twoBody();
+    return failures ? 1 : 0;
+}
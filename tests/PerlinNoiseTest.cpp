@@ -0,0 +1,62 @@
+// Checks that the batch row kernels behind Grid::assignValues(perlin) agree with
+// PerlinNoise::noise at every node, within 1e-6, however far the nodes are from the
+// lattice origin.
+//
+// usage: PerlinNoiseTest   (exit status 1 if a check fails)
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "Grid/Grid.hpp"
+#include "PerlinNoise/PerlinNoise.hpp"
+
+namespace
+{
+    const float bound { 1e-6f };
+
+    int failures { 0 };
+
+    void check(const std::string& name, const PerlinNoise& perlin, const float size, const unsigned int resolution, const float t)
+    {
+        Grid grid { size, size, resolution, perlin };
+        grid.assignValues(perlin, t);
+
+        float worst { 0.0f };
+        for (unsigned int idx = 0; idx < grid.size(); ++idx)
+        {
+            worst = std::max(worst, std::fabs(grid.data()[idx] - perlin.noise(grid.position(idx), t)));
+        }
+        if (worst > bound)
+        {
+            std::cerr << name << ": FAILED, max difference " << worst << '\n';
+            ++failures;
+        }
+        else
+        {
+            std::cerr << name << ": ok, max difference " << worst << '\n';
+        }
+    }
+}
+
+int main()
+{
+    std::cerr << "kernel: " << PerlinNoise::kernelName() << '\n';
+
+    // the stored 10 x 10 lattice spans the grid
+    const PerlinNoise stored { 768.0f, 768.0f, 10, false };
+    check("stored lattice", stored, 768.0f, 1000, 0.0f);
+
+    // hashed lattice with 85 unit cells, on domains up to about 9000 cells wide
+    PerlinNoise hashed { 768.0f / 9, 768.0f / 9, 1u };
+    for (const float size : { 768.0f, 76800.0f, 768000.0f })
+    {
+        check("hashed lattice, " + std::to_string(static_cast<int>(size)) + " wide", hashed, size, 1000, 0.3f);
+    }
+    check("hashed lattice, 4000 nodes", hashed, 7680.0f, 4000, 0.3f);
+
+    hashed.setOctaves(4);
+    check("hashed lattice, 4 octaves", hashed, 76800.0f, 1000, 0.3f);
+
+    return failures ? 1 : 0;
+}
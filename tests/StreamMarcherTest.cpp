@@ -0,0 +1,127 @@
+// Equivalence checks for StreamMarcher: streaming a grid's rows must give exactly the
+// segments MarchingSquares finds on the whole grid, in the same order, whether the rows
+// come from memory or through the raw float32 reader and writer.
+//
+// usage: StreamMarcherTest   (exit status 1 if a check fails)
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "Grid/Grid.hpp"
+#include "MarchingSquares/MarchingSquares.hpp"
+#include "StreamMarcher/StreamMarcher.hpp"
+
+namespace
+{
+    const float isolevel { 0.1f };
+
+    int failures { 0 };
+
+    float waves(const glm::vec2& p)
+    {
+        return std::sin(p.x * 0.05f) * std::cos(p.y * 0.037f) + 0.3f * std::sin((p.x + p.y) * 0.11f);
+    }
+
+    // the rows of a grid
+    class GridReader : public RowReader
+    {
+    private:
+        const Grid& m_grid;
+        unsigned int m_row { 0 };
+
+    public:
+        explicit GridReader(const Grid& grid) : m_grid { grid } {}
+
+        bool read(float* row, const unsigned int width) override
+        {
+            if (m_row == m_grid.rows()) { return false; }
+            std::memcpy(row, m_grid.data() + m_row * m_grid.stride(), width * sizeof(float));
+            ++m_row;
+            return true;
+        }
+    };
+
+    class CollectingSink : public SegmentSink
+    {
+    public:
+        std::vector<Point> points {};
+
+        void write(const std::vector<Point>& segment_points) override
+        {
+            points.insert(points.end(), segment_points.begin(), segment_points.end());
+        }
+    };
+
+    void report(const char* name, const bool ok)
+    {
+        std::cerr << name << (ok ? ": ok\n" : ": FAILED\n");
+        if (!ok) { ++failures; }
+    }
+
+    bool samePoints(const std::vector<Point>& a, const std::vector<Point>& b)
+    {
+        if (a.size() != b.size()) { return false; }
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            if (!(a[i].position() == b[i].position())) { return false; }
+        }
+        return true;
+    }
+
+    void fromMemory()
+    {
+        const Grid grid { 768.0f, 768.0f, 300, waves };
+        bool ok { true };
+        for (const bool interp : { false, true })
+        {
+            MarchingSquares expected { isolevel, interp, grid };
+            StreamMarcher stream { grid.resolution(), grid.origin(), grid.dx(), grid.dy(), isolevel, interp };
+            GridReader reader { grid };
+            CollectingSink sink;
+            const std::size_t rows { stream.march(reader, sink) };
+            ok = ok && rows == grid.rows() && samePoints(sink.points, expected.points());
+        }
+        report("streamed rows == MarchingSquares", ok);
+    }
+
+    // the first 60 of 120 columns, so more rows than columns, through RawRowReader and RawSegmentSink
+    void rawStreams()
+    {
+        const Grid tall { 200.0f, 200.0f, 120, waves };
+        std::stringstream raw;
+        for (unsigned int y_i = 0; y_i < tall.rows(); ++y_i)
+        {
+            raw.write(reinterpret_cast<const char*>(tall.data() + y_i * tall.stride()), 60 * sizeof(float));
+        }
+
+        StreamMarcher stream { 60, tall.origin(), tall.dx(), tall.dy(), isolevel, true };
+        RawRowReader reader { raw };
+        std::stringstream out;
+        RawSegmentSink sink { out };
+        const std::size_t rows { stream.march(reader, sink) };
+
+        std::vector<Point> streamed;
+        float xy[2];
+        while (out.read(reinterpret_cast<char*>(xy), sizeof(xy))) { streamed.emplace_back(xy[0], xy[1]); }
+
+        // the same 60 columns, marched whole
+        Grid narrow { 60, tall.rows(), tall.origin(), tall.dx(), tall.dy() };
+        for (unsigned int y_i = 0; y_i < tall.rows(); ++y_i)
+        {
+            std::memcpy(narrow.data() + y_i * narrow.stride(), tall.data() + y_i * tall.stride(), 60 * sizeof(float));
+        }
+        narrow.markAllDirty();
+        MarchingSquares expected { isolevel, true, narrow };
+        report("raw float32 streams == MarchingSquares", rows == tall.rows() && !expected.points().empty() && samePoints(streamed, expected.points()));
+    }
+}
+
+int main()
+{
+    fromMemory();
+    rawStreams();
+    return failures ? 1 : 0;
+}